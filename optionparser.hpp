@@ -22,13 +22,34 @@
 
 #include <iostream>
 #include <sstream>
+#include <fstream>
 #include <iomanip>
 #include <string>
+#include <string_view>
+#include <array>
 #include <vector>
+#include <iterator>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <unordered_map>
 #include <exception>
 #include <stdexcept>
 #include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+/* memory-mapping of schema files (see BasicOptionParser::load()); read into memory elsewhere */
+#if defined(__unix__) || defined(__APPLE__)
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #define OPTIONPARSER_HAVE_MMAP
+#endif
 
 /* some features explicitly need minimum c++17 support */
 #if ((__cplusplus != 201402L) && (__cplusplus < 201402L)) && (defined(_MSC_VER) && ((_MSC_VER != 1914) || (_MSC_VER < 1914)))
@@ -74,7 +95,6 @@
 * -----------------------------------------
 *
 * things to do / implement:
-*   - LLVM style options (single dash + fullstring, i.e., "-use-whatever", "use-whatever" being the key)
 *   - "conditional" parsing, a la /bin/find. stuff like, say, "-if -then" ... which is to say
 *     the *order* is important, not the actual flow. the order is kept in the same order they're
 *     declared, since that's how arrays (more specifically, std::vector) work ...
@@ -117,22 +137,51 @@ class BasicOptionParser
             using Error::Error;
         };
 
+        struct AmbiguousOptionError: InvalidOptionError
+        {
+            using InvalidOptionError::InvalidOptionError;
+        };
+
         class Value;
+        class ParseContext;
         using string             = std::basic_string<CharT>;
+        using string_view        = std::basic_string_view<CharT>;
         using stringstream       = std::basic_stringstream<CharT>;
         using StopIfCallback     = std::function<bool(BasicOptionParser&)>;
+        using StopIfContextCallback = std::function<bool(const ParseContext&)>;
         using UnknownOptCallback = std::function<bool(const string&)>;
         using CallbackNoValue    = std::function<void()>;
         using CallbackWithValue  = std::function<void(const Value&)>;
+        using CallbackNumeric    = std::function<void(long long)>;
+        using CallbackToggle     = std::function<void(bool)>;
+        using CommandFactory     = std::function<void(BasicOptionParser&)>;
+
+        // denotes "no such declaration/name" for the id based tables
+        static constexpr uint32_t npos = uint32_t(-1);
+
+        // what decodechar() returns for invalid sequences; not a valid code point
+        static constexpr uint32_t badchar = 0x110000;
+
+        // per-declaration flags, stored in Schema::declflags
+        enum DeclFlags: uint8_t
+        {
+            // this decl needs a value
+            DECL_NEEDVALUE = (1 << 0),
+
+            // this decl accepts "--no-<name>" for each of its long names (see onNegatable())
+            DECL_NEGATABLE = (1 << 1),
+        };
 
         /*
         * this only used for native C++ - provides
         * deparsing string value into integers, etc.
+        * the value is a view into the argument it was taken from, and hence only
+        * valid during the callback; use str() to keep it.
         */
         class Value
         {
             private:
-                string m_rawvalue;
+                string_view m_rawvalue;
 
             public: // static functions - doubles as helper function(s)
                 template<typename OutType>
@@ -150,17 +199,23 @@ class BasicOptionParser
                 }
 
             public: // members
-                Value(const string& raw): m_rawvalue(raw)
+                Value(string_view raw): m_rawvalue(raw)
                 {
                 }
 
                 template<typename OutType>
                 OutType as() const
                 {
-                    return Value::lexical_convert<OutType>(m_rawvalue);
+                    return Value::lexical_convert<OutType>(str());
                 }
 
                 string str() const
+                {
+                    return string(m_rawvalue);
+                }
+
+                // the value as-is, without copying it.
+                inline string_view view() const
                 {
                     return m_rawvalue;
                 }
@@ -180,9 +235,10 @@ class BasicOptionParser
                     return size();
                 }
 
+                // like std::string, past the end is NUL - even though the view may not be terminated.
                 inline int operator[](int i) const
                 {
-                    return m_rawvalue[i];
+                    return charat(m_rawvalue, size_t(i));
                 }
         };
 
@@ -191,6 +247,12 @@ class BasicOptionParser
         {
             CallbackWithValue real_callback = nullptr;
 
+            // only set for numeric families
+            CallbackNumeric real_numcallback = nullptr;
+
+            // only set for negatable declarations
+            CallbackToggle real_togglecallback = nullptr;
+
             // default - no callback
             Callback()
             {
@@ -217,598 +279,3502 @@ class BasicOptionParser
                 };
             }
 
-            void check()
+            // a callback accepting an already decoded integer (see onNumber())
+            Callback(CallbackNumeric cb)
+            {
+                real_numcallback = cb;
+                real_callback = [cb](const Value& v)
+                {
+                    return cb(v.template as<long long>());
+                };
+            }
+
+            // a callback accepting the polarity of a negatable option (see onNegatable())
+            Callback(CallbackToggle cb)
+            {
+                real_togglecallback = cb;
+                real_callback = [cb](const Value& v)
+                {
+                    (void)v;
+                    return cb(true);
+                };
+            }
+
+            void check() const
             {
                 if(real_callback == nullptr)
                 {
-                    throw std::runtime_error("real_callback is NULL");
+                    // i.e., an option of a parser returned by load(), which was never bound
+                    throwError<Error>("option has no callback; bind() one first");
                 }
             }
 
-            void invoke()
+            void invoke() const
             {
                 check();
-                return real_callback(std::string());
+                return real_callback(string_view());
             }
 
-            void invoke(const string& s)
+            void invoke(string_view s) const
             {
                 check();
                 return real_callback(s);
             }
-        };
 
-        struct LongOption
-        {
-            string name;
+            void invoke_toggle(bool on) const
+            {
+                if(real_togglecallback == nullptr)
+                {
+                    throw std::runtime_error("real_togglecallback is NULL");
+                }
+                return real_togglecallback(on);
+            }
 
-            /*
-            * this isn't really used yet - ideally, it would
-            * be used to specify the type of parsing:
-            * if true, it would parse GNU style options, like "--verbose", or "--prefix=foo".
-            * if false, it would parse MS-DOS style options, like "/verbose" ("/v"), or "/out:whatever.txt".
-            * this would also need a more thorough definition spec for short
-            * options.
-            *
-            * tl;dr possible, but mixing these seems like a great way to needlessly
-            * complicate everything
-            */
-            bool isgnu;
+            void invoke_number(long long n) const
+            {
+                if(real_numcallback == nullptr)
+                {
+                    throw std::runtime_error("real_numcallback is NULL");
+                }
+                return real_numcallback(n);
+            }
         };
 
-        struct Declaration
+        /**
+        * the state of a single parse run: the arguments, the positional values
+        * that were left over, and the subcommand that was seen, if any.
+        * since the parser itself is not modified by parse(ParseContext&, ...), any
+        * number of threads may parse against the same parser at once, each with
+        * their own ParseContext - provided the parser was frozen (see freeze()),
+        * and the callbacks are safe to call concurrently.
+        */
+        class ParseContext
         {
-            // whether or not this decl has a short option (wip)
-            bool has_short = false;
+            friend class BasicOptionParser;
 
-            // whether or not this decl has a long option (wip)
-            bool has_long = false;
+            private:
+                /*
+                * the arguments being parsed: views into the argv or range passed to parse(),
+                * or into m_argstore.
+                */
+                std::vector<string_view> m_vargs;
 
-            // whether this decl needs a value. this is declared
-            // through appending '?' to the short opt syntax, and '=?' to
-            // the long opt syntax.
-            bool needvalue = false;
+                /*
+                * the strings of arguments that were not passed as argv or range, and hence
+                * may not outlive the call to parse(); one vector per call. adding another
+                * one never moves the strings that m_vargs and m_positional point into.
+                * only the first m_argbatches are in use - the others are kept for their
+                * memory, and reused by later runs.
+                */
+                std::vector<std::vector<string>> m_argstore;
 
-            // whether this decl has a placeholder
-            bool hasplaceholder = false;
+                // see m_argstore.
+                size_t m_argbatches = 0;
 
-            // the name of the short option (i.e., "o")
-            std::vector<CharT> shortnames;
+                // positional values, i.e., any non-options; views like m_vargs.
+                std::vector<string_view> m_positional;
 
-            // the name of the long option (i.e., "out")
-            std::vector<LongOption> longnames;
+                /*
+                * the parsers of the enclosing commands (outermost first), if this is
+                * the context of a subcommand. options of these are still recognized.
+                */
+                std::vector<const BasicOptionParser*> m_outer;
 
-            // the description (no special syntax!) (i.e., "set output file name")
-            string description;
+                // index of the command that was seen, or npos.
+                uint32_t m_commandidx = npos;
 
-            // name of the placeholder (i.e., "--foo=<something>" = "something")
-            string placeholder = "val";
+                // name of the command that was seen.
+                string m_commandname;
 
-            // the lambda/function to be called when this option is seen
-            Callback callback;
+                // the state of the subcommand run; kept for reuse if no command was seen.
+                std::unique_ptr<ParseContext> m_command;
 
-            // a ref to OptionParser - used for alias
-            BasicOptionParser* selfref;
+                // index of the next argument to parse; the ones before it are done.
+                size_t m_next = 0;
 
-            // return true if $c is recognized as short option
-            inline bool is(CharT c) const
-            {
-                size_t i;
-                for(i=0; i<shortnames.size(); i++)
+                // size of m_positional when the run began. a command must come before any other positional value.
+                size_t m_posbegin = 0;
+
+                // whether "--" was seen, or a stop_if callback said so.
+                bool m_stopparsing = false;
+
+                // whether arguments are being fed one at a time (see feed()), so that more may follow.
+                bool m_feeding = false;
+
+                // whether the argument at m_next waits for the one after it to be fed.
+                bool m_waiting = false;
+
+            private:
+                /*
+                * makes the strings of [$begin, $end) the arguments to parse, without
+                * copying them. they must outlive the views - argv outlives any parse run.
+                */
+                template<typename IterT>
+                void borrowargs(IterT begin, IterT end)
                 {
-                    if(shortnames[i] == c)
+                    using RefT = decltype(*begin);
+                    using CategoryT = typename std::iterator_traits<IterT>::iterator_category;
+                    // input iterators (i.e., of a stream) may reuse the string they return
+                    static_assert(std::is_base_of<std::forward_iterator_tag, CategoryT>::value, "arguments must be a forward range");
+                    static_assert(std::is_lvalue_reference<RefT>::value || !std::is_same<typename std::decay<RefT>::type, string>::value,
+                        "strings returned by value are gone before they could be parsed");
+                    m_vargs.clear();
+                    m_vargs.reserve(std::distance(begin, end));
+                    for(; begin!=end; ++begin)
                     {
-                        return true;
+                        m_vargs.emplace_back(*begin);
                     }
                 }
-                return false;
-            }
 
-            // return true if $s is recognized as long option
-            inline bool is(const string& s) const
-            {
-                size_t i;
-                for(i=0; i<longnames.size(); i++)
+                // like borrowargs(IterT, IterT), but for argv, from $begin on.
+                void borrowargs(int argc, char** argv, int begin)
+                {
+                    borrowargs(argv + begin, argv + ((argc > begin) ? argc : begin));
+                }
+
+                /*
+                * returns the next unused vector of m_argstore.
+                * the store is only recycled if no positional values may point into it.
+                */
+                std::vector<string>& nextbatch()
                 {
-                    if(longnames[i].name == s)
+                    if(m_positional.empty())
                     {
-                        return true;
+                        m_argbatches = 0;
+                    }
+                    if(m_argbatches == m_argstore.size())
+                    {
+                        m_argstore.emplace_back();
                     }
+                    return m_argstore[m_argbatches++];
                 }
-                return false;
-            }
 
-            inline string to_short_str() const
-            {
-                size_t i;
-                stringstream buf;
-                for(i=0; i<shortnames.size(); i++)
+                // makes the arguments empty, for feed() to append to.
+                void clearargs()
                 {
-                    buf << "-" << shortnames[i];
-                    if(needvalue)
+                    if(m_positional.empty())
                     {
-                        buf << "<" << placeholder << ">";
+                        m_argbatches = 0;
                     }
-                    if((i + 1) != shortnames.size())
+                    m_vargs.clear();
+                }
+
+                // makes the first $count strings of $batch the arguments to parse.
+                void viewbatch(const std::vector<string>& batch, size_t count)
+                {
+                    size_t i;
+                    m_vargs.clear();
+                    m_vargs.reserve(count);
+                    for(i=0; i<count; i++)
                     {
-                        buf << " ";
+                        m_vargs.push_back(batch[i]);
                     }
                 }
-                return buf.str();
-            }
 
-            inline string to_long_str(size_t padsize=35) const
-            {
-                size_t i;
-                size_t realpad;
-                size_t tmplen;
-                stringstream buf;
-                stringstream tmp;
-                tmp << to_short_str();
-                tmp << " ";
-                for(i=0; i<longnames.size(); i++)
+                // takes over $args, and makes them the arguments to parse.
+                void storeargs(std::vector<string>&& args)
                 {
-                    if(longnames[i].isgnu)
+                    std::vector<string>& batch = nextbatch();
+                    batch = std::move(args);
+                    viewbatch(batch, batch.size());
+                }
+
+                /*
+                * appends a copy of $arg to the arguments, reusing a string of an earlier run.
+                * every one gets a vector of its own, since growing a vector would move the
+                * strings that the arguments before it point into.
+                */
+                void appendarg(string_view arg)
+                {
+                    if(m_argbatches == m_argstore.size())
                     {
-                        tmp << "--" << longnames[i].name;
-                        if(needvalue)
-                        {
-                            tmp << "=<" << placeholder << ">";
-                        }
+                        m_argstore.emplace_back();
+                    }
+                    std::vector<string>& batch = m_argstore[m_argbatches++];
+                    if(batch.empty())
+                    {
+                        batch.emplace_back(arg);
                     }
                     else
                     {
-                        tmp << "/" << longnames[i].name;
-                        if(needvalue)
-                        {
-                            tmp << ":<" << placeholder << ">";
-                        }
+                        batch[0] = arg;
                     }
-                    if((i + 1) < longnames.size())
+                    m_vargs.push_back(batch[0]);
+                }
+
+                /*
+                * makes copies of [$begin, $end) the arguments to parse.
+                * the copies are assigned to the strings of an earlier run, as far as there
+                * are any, so that their memory is reused. surplus strings are kept for later.
+                */
+                template<typename IterT>
+                void copyargs(IterT begin, IterT end)
+                {
+                    size_t count;
+                    std::vector<string>& batch = nextbatch();
+                    for(count=0; begin!=end; ++begin, count++)
                     {
-                        tmp << ", ";
+                        if(count < batch.size())
+                        {
+                            batch[count] = *begin;
+                        }
+                        else
+                        {
+                            batch.emplace_back(*begin);
+                        }
                     }
+                    viewbatch(batch, count);
                 }
-                tmplen = tmp.tellp();
-                realpad = ((tmplen <= padsize) ? padsize : (tmplen + 2));
-                buf << "  " << tmp.str() << ":";
-                while(true)
+
+            public:
+                /**
+                * discards the state of the last run, but keeps the memory it took, so that
+                * parsing into $this again allocates nothing, unless it sees more (or, if
+                * copied, longer) arguments or positional values than any run before it.
+                */
+                void reset()
                 {
-                    buf << " ";
-                    if(size_t(buf.tellp()) >= realpad)
+                    m_vargs.clear();
+                    m_positional.clear();
+                    m_outer.clear();
+                    m_argbatches = 0;
+                    m_commandidx = npos;
+                    m_commandname.clear();
+                    m_feeding = false;
+                }
+
+                /**
+                * returns the positional (non-parsed) values.
+                * these are views into the arguments, which stay valid until $this is parsed
+                * into again, or destroyed. if the arguments were passed as argv, or as a
+                * range of strings, they point into those, which must live that long as well.
+                */
+                inline const std::vector<string_view>& positional() const
+                {
+                    return m_positional;
+                }
+
+                /**
+                * returns argument idx of the positional values.
+                */
+                inline string_view positional(size_t idx) const
+                {
+                    return m_positional[idx];
+                }
+
+                /**
+                * returns the amount of positional values.
+                */
+                inline size_t size() const
+                {
+                    return m_positional.size();
+                }
+
+                /**
+                * returns the state of the subcommand run, or nullptr if no command was seen.
+                */
+                inline const ParseContext* command() const
+                {
+                    if(m_commandidx == npos)
                     {
-                        break;
+                        return nullptr;
                     }
+                    return m_command.get();
                 }
-                buf << description;
-                return buf.str();
-            }
 
-            Declaration& alias(const std::vector<string>& opts);
+                /**
+                * returns the name of the subcommand that was seen, or an empty string.
+                */
+                inline const string& commandName() const
+                {
+                    return m_commandname;
+                }
         };
 
+        // placeholder used in help(), if none was declared
+        static constexpr CharT defaultplaceholder[] = {'v', 'a', 'l', 0};
+
         /*
-        * big TODO: read options from a file, i.e.,
-        * if declaration is like on({"-v", "--verbose"}, ...), then
-        * FileParser would look for token "verbose", and process it as
-        * if passed on the command line.
-        * like a configuration file, basically.
-        * idea: add additional parameter to on() to explicitly specify
-        * configuration file variable name (i.e., on({"-v", "--verbose"}, "use-verbose", "...", []{...}))
+        * a monotonic arena: memory is handed out from large blocks, and only ever
+        * released all at once, when the arena itself is destroyed.
+        * hence, anything allocated from it must be trivially destructible.
         */
-        class FileParser
+        class Arena
         {
-            public:
             private:
-                std::istream* m_stream;
-                std::string m_filename;
-                bool m_mustclose;
+                static constexpr size_t blocksize = 4096;
 
             private:
-                std::istream* openFile(const std::string& path)
-                {
-                    std::fstream* strm;
-                    strm = new std::fstream(path, std::ios::in | std::ios::binary);
-                    return strm;
-                }
+                std::vector<std::unique_ptr<unsigned char[]>> m_blocks;
+                unsigned char* m_current = nullptr;
+                size_t m_left = 0;
 
-                void check()
+            public:
+                void* allocate(size_t size, size_t align)
                 {
-                    std::stringstream ss;
-                    if(!m_stream->good())
+                    size_t pad;
+                    unsigned char* ptr;
+                    pad = ((align - (uintptr_t(m_current) % align)) % align);
+                    if((m_current == nullptr) || ((size + pad) > m_left))
                     {
-                        ss << "failed to open '" << m_filename << "' for reading";
-                        throw IOError(ss.str());
+                        // oversized requests get a block of their own, so the current block is kept
+                        if((size + align) > (blocksize / 4))
+                        {
+                            m_blocks.emplace_back(new unsigned char[size + align]);
+                            ptr = m_blocks.back().get();
+                            return (ptr + ((align - (uintptr_t(ptr) % align)) % align));
+                        }
+                        m_blocks.emplace_back(new unsigned char[blocksize]);
+                        m_current = m_blocks.back().get();
+                        m_left = blocksize;
+                        pad = ((align - (uintptr_t(m_current) % align)) % align);
                     }
+                    ptr = (m_current + pad);
+                    m_current += (pad + size);
+                    m_left -= (pad + size);
+                    return ptr;
                 }
 
-            public:
-                // allow using an already existing stream
-                // FileParser...(&alreadyexistingstream, "somefilename") ...
-                FileParser(std::istream* strm, const std::string& filename, bool mustclose=false):
-                    m_stream(strm), m_filename(filename), m_mustclose(mustclose)
+                template<typename Type>
+                Type* make()
                 {
-                    check();
+                    static_assert(std::is_trivially_destructible<Type>::value, "arena objects are never destroyed");
+                    return new(allocate(sizeof(Type), alignof(Type))) Type();
                 }
 
-                FileParser(const std::string& path):
-                    FileParser(openFile(path), true)
-                {}
-
-                ~FileParser()
+                // copies $str into the arena
+                std::basic_string_view<CharT> intern(const CharT* str, size_t len)
                 {
-                    if(m_mustclose)
+                    CharT* dest;
+                    if(len == 0)
                     {
-                        delete m_stream;
+                        return std::basic_string_view<CharT>();
                     }
+                    dest = static_cast<CharT*>(allocate(len * sizeof(CharT), alignof(CharT)));
+                    std::char_traits<CharT>::copy(dest, str, len);
+                    return std::basic_string_view<CharT>(dest, len);
                 }
         };
 
-        // wrap around isalnum to permit '?', '!', '#', etc.
-        static inline bool isalphanum(CharT c)
-        {
-            static const string other = "?!#";
-            return (std::isalnum(int(c)) || (other.find_first_of(c) != string::npos));
-        }
-
-        // is it a valid long option?
-        static inline bool isvalidlongopt(const string& str)
+        /*
+        * a read-only file, memory-mapped where possible, otherwise read into memory.
+        * used by load(); declaration strings point straight into it.
+        */
+        class MappedFile
         {
-            return ((str[0] == '-') && (str[1] == '-'));
-        }
+            private:
+                const unsigned char* m_data = nullptr;
+                size_t m_size = 0;
+                bool m_mapped = false;
+                std::unique_ptr<unsigned char[]> m_buffer;
 
-        // is it a valid DOS-style option?
-        static inline bool isvaliddosopt(const string& str)
-        {
-            return ((str[0] == '/') && isalphanum(str[1]));
-        }
+            public:
+                MappedFile(const std::string& path)
+                {
+                #if defined(OPTIONPARSER_HAVE_MMAP)
+                    int fd;
+                    void* addr;
+                    struct stat st;
+                    fd = ::open(path.c_str(), O_RDONLY);
+                    if(fd == -1)
+                    {
+                        throwError<IOError>("failed to open '", path, "' for reading");
+                    }
+                    if((::fstat(fd, &st) == -1) || (st.st_size == 0))
+                    {
+                        ::close(fd);
+                        throwError<IOError>("failed to map '", path, "': empty or unreadable");
+                    }
+                    addr = ::mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+                    ::close(fd);
+                    if(addr == MAP_FAILED)
+                    {
+                        throwError<IOError>("failed to map '", path, "'");
+                    }
+                    m_data = static_cast<const unsigned char*>(addr);
+                    m_size = size_t(st.st_size);
+                    m_mapped = true;
+                #else
+                    std::ifstream strm(path, std::ios::in | std::ios::binary);
+                    if(!strm.good())
+                    {
+                        throwError<IOError>("failed to open '", path, "' for reading");
+                    }
+                    strm.seekg(0, std::ios::end);
+                    m_size = size_t(strm.tellg());
+                    strm.seekg(0, std::ios::beg);
+                    m_buffer.reset(new unsigned char[m_size]);
+                    strm.read(reinterpret_cast<char*>(m_buffer.get()), m_size);
+                    if(!strm.good())
+                    {
+                        throwError<IOError>("failed to read '", path, "'");
+                    }
+                    m_data = m_buffer.get();
+                #endif
+                }
 
-    protected:
-        // contains the argc/argv.
-        std::vector<string> m_vargs;
+                MappedFile(const MappedFile&) = delete;
+                MappedFile& operator=(const MappedFile&) = delete;
 
-        // contains unparsed, positional arguments. i.e, any non-options.
-        std::vector<string> m_positional;
+                ~MappedFile()
+                {
+                #if defined(OPTIONPARSER_HAVE_MMAP)
+                    if(m_mapped)
+                    {
+                        ::munmap(const_cast<unsigned char*>(m_data), m_size);
+                    }
+                #endif
+                }
 
-        // contains the option syntax declarations.
-        std::vector<Declaration*> m_declarations;
+                inline const unsigned char* data() const
+                {
+                    return m_data;
+                }
 
-        // stop_if callbacks
-        std::vector<StopIfCallback> m_stopif_funcs;
+                inline size_t size() const
+                {
+                    return m_size;
+                }
+        };
 
-        // buffer for the banner (the text printed prior to the help text)
-        stringstream m_helpbannerbuf;
+        /*
+        * writes the sections of a schema file (see save()): plain values, and arrays,
+        * which are prefixed by their length, and padded to 8 bytes, so that every
+        * array is suitably aligned in the mapped file.
+        */
+        class SchemaWriter
+        {
+            private:
+                std::ostream& m_out;
+                size_t m_pos = 0;
 
-        // buffer for the tail (the text printed after the help text)
-        stringstream m_helptailbuf;
+            private:
+                void write(const void* data, size_t size)
+                {
+                    m_out.write(static_cast<const char*>(data), size);
+                    m_pos += size;
+                }
 
-        // true, if any DOS style options had been declared.
-        // only meaningful in parse() - DOS options are usually ignored.
-        bool m_dosoptsdeclared = false;
+            public:
+                SchemaWriter(std::ostream& out): m_out(out)
+                {
+                }
 
-        // a handler for unknown/errornous options
-        UnknownOptCallback m_on_unknownoptfn;
+                template<typename Type>
+                void value(const Type& val)
+                {
+                    static_assert(std::is_trivially_copyable<Type>::value, "only plain data can be written");
+                    static_assert(std::has_unique_object_representations<Type>::value, "padding would be written");
+                    write(&val, sizeof(Type));
+                }
 
-    protected:
-        /*
-        * todo: more meaningful exception classes
+                template<typename Type>
+                void array(const Type* data, size_t count)
+                {
+                    static const unsigned char zeros[8] = {};
+                    static_assert(std::is_trivially_copyable<Type>::value, "only plain data can be written");
+                    static_assert(std::has_unique_object_representations<Type>::value, "padding would be written");
+                    value(uint64_t(count));
+                    if(count > 0)
+                    {
+                        write(data, count * sizeof(Type));
+                    }
+                    write(zeros, ((8 - (m_pos % 8)) % 8));
+                }
+        };
+
+        /*
+        * reads what SchemaWriter wrote, from a MappedFile.
+        * anything out of bounds (or otherwise inconsistent) throws IOError.
+        */
+        class SchemaReader
+        {
+            private:
+                const unsigned char* m_data;
+                size_t m_size;
+                size_t m_pos = 0;
+
+            public:
+                SchemaReader(const unsigned char* data, size_t size): m_data(data), m_size(size)
+                {
+                }
+
+                inline void expect(bool cond) const
+                {
+                    if(!cond)
+                    {
+                        throwError<IOError>("schema file is truncated or corrupt");
+                    }
+                }
+
+                template<typename Type>
+                Type value()
+                {
+                    Type val;
+                    expect(sizeof(Type) <= (m_size - m_pos));
+                    std::memcpy(&val, m_data + m_pos, sizeof(Type));
+                    m_pos += sizeof(Type);
+                    return val;
+                }
+
+                // returns a pointer to the array in the file itself, storing its length in $count.
+                template<typename Type>
+                const Type* array(size_t& count)
+                {
+                    uint64_t len;
+                    const Type* ptr;
+                    len = value<uint64_t>();
+                    expect(len <= ((m_size - m_pos) / sizeof(Type)));
+                    ptr = reinterpret_cast<const Type*>(m_data + m_pos);
+                    count = size_t(len);
+                    m_pos += (count * sizeof(Type));
+                    m_pos += ((8 - (m_pos % 8)) % 8);
+                    expect(m_pos <= m_size);
+                    return ptr;
+                }
+
+                // like array(), but copies it into $dest.
+                template<typename Type>
+                void array(std::vector<Type>& dest)
+                {
+                    size_t count;
+                    const Type* ptr;
+                    ptr = array<Type>(count);
+                    dest.resize(count);
+                    if(count > 0)
+                    {
+                        std::memcpy(dest.data(), ptr, count * sizeof(Type));
+                    }
+                }
+        };
+
+        /*
+        * a declared option name. the name itself is interned in Schema::nametable.
+        */
+        struct NameRef
+        {
+            enum Kind: uint8_t
+            {
+                // getopt style short option, like "-o"
+                SHORT = 0,
+
+                // GNU style long option, like "--verbose", or "--prefix=foo"
+                GNU = 1,
+
+                // MS-DOS style option, like "/verbose" ("/v"), or "/out:whatever.txt"
+                DOS = 2,
+
+                // prefix family, like "-W" (declared as "-W*"); the name includes the dash(es)
+                FAMILY = 3,
+
+                // numeric family, like "-O" (for "-O3"), or "-" (for "-9"); see onNumber()
+                NUMERIC = 4,
+            };
+
+            // offset and length of the name in Schema::nametable
+            uint32_t offset;
+            uint32_t length;
+
+            // id of the declaration this name belongs to
+            uint32_t decl;
+
+            // index of the next name of the same declaration in Schema::names, or npos
+            uint32_t next;
+
+            // see Kind
+            uint8_t kind;
+
+            // always zero: spells out the padding, so that save() writes no stray bytes
+            uint8_t unused[3] = {};
+        };
+
+    protected:
+        struct Schema;
+
+    public:
+        /*
+        * a declaration, as seen by the user - or rather, the cold part of it, which is
+        * only needed by help() and alias().
+        * everything needed while parsing (flags, callback, names) lives in the hot arrays
+        * of the Schema, indexed by $id.
+        */
+        struct Declaration
+        {
+            // index of this declaration in Schema::declarations, and the hot arrays
+            uint32_t id = 0;
+
+            // first and last name of this declaration in Schema::names (linked through NameRef::next)
+            uint32_t firstname = npos;
+            uint32_t lastname = npos;
+
+            // whether this decl has a placeholder
+            bool hasplaceholder = false;
+
+            // the description (no special syntax!) (i.e., "set output file name")
+            std::basic_string_view<CharT> description;
+
+            // name of the placeholder (i.e., "--foo=<something>" = "something")
+            std::basic_string_view<CharT> placeholder = defaultplaceholder;
+
+            // a ref to OptionParser - used for alias
+            BasicOptionParser* selfref;
+
+            // the schema this declaration belongs to - used to look up names
+            const Schema* schema;
+
+            // whether this decl needs a value. this is declared
+            // through appending '?' to the short opt syntax, and '=?' to
+            // the long opt syntax.
+            inline bool needvalue() const
+            {
+                return ((schema->declflags[id] & DECL_NEEDVALUE) != 0);
+            }
+
+            inline string to_short_str() const
+            {
+                uint32_t n;
+                bool first;
+                stringstream buf;
+                first = true;
+                for(n=firstname; n!=npos; n=schema->names[n].next)
+                {
+                    const NameRef& ref = schema->names[n];
+                    if((ref.kind != NameRef::SHORT) && (ref.kind != NameRef::FAMILY) && (ref.kind != NameRef::NUMERIC))
+                    {
+                        continue;
+                    }
+                    if(!first)
+                    {
+                        buf << " ";
+                    }
+                    first = false;
+                    if(ref.kind == NameRef::FAMILY)
+                    {
+                        buf << schema->name_str(ref) << "*";
+                        continue;
+                    }
+                    if(ref.kind == NameRef::NUMERIC)
+                    {
+                        buf << schema->name_str(ref) << "<N>";
+                        continue;
+                    }
+                    buf << "-" << schema->name_str(ref);
+                    if(needvalue())
+                    {
+                        buf << "<" << placeholder << ">";
+                    }
+                }
+                return buf.str();
+            }
+
+            inline string to_long_str(size_t padsize=35) const
+            {
+                uint32_t n;
+                bool first;
+                size_t realpad;
+                size_t tmplen;
+                stringstream buf;
+                stringstream tmp;
+                first = true;
+                tmp << to_short_str();
+                tmp << " ";
+                for(n=firstname; n!=npos; n=schema->names[n].next)
+                {
+                    const NameRef& ref = schema->names[n];
+                    if((ref.kind != NameRef::GNU) && (ref.kind != NameRef::DOS))
+                    {
+                        continue;
+                    }
+                    if(!first)
+                    {
+                        tmp << ", ";
+                    }
+                    first = false;
+                    if(ref.kind == NameRef::GNU)
+                    {
+                        tmp << "--" << ((schema->declflags[id] & DECL_NEGATABLE) ? "[no-]" : "") << schema->name_str(ref);
+                        if(needvalue())
+                        {
+                            tmp << "=<" << placeholder << ">";
+                        }
+                    }
+                    else
+                    {
+                        tmp << "/" << schema->name_str(ref);
+                        if(needvalue())
+                        {
+                            tmp << ":<" << placeholder << ">";
+                        }
+                    }
+                }
+                tmplen = tmp.tellp();
+                realpad = ((tmplen <= padsize) ? padsize : (tmplen + 2));
+                buf << "  " << tmp.str() << ":";
+                while(true)
+                {
+                    buf << " ";
+                    if(size_t(buf.tellp()) >= realpad)
+                    {
+                        break;
+                    }
+                }
+                buf << description;
+                return buf.str();
+            }
+
+            /*
+            * adds the options in $opts as further names of this declaration.
+            * they use the same syntax as on(), and must agree with this declaration
+            * on whether a value is needed.
+            * aliases are just additional entries in the lookup indexes; the callback
+            * and description are shared, not copied.
+            */
+            Declaration& alias(const std::vector<string>& opts)
+            {
+                // declarations of a parser returned by load() belong to no parser until bound
+                if(selfref == nullptr)
+                {
+                    throwError<Error>("declaration is not bound to a parser; bind() it first");
+                }
+                selfref->addAliases(*this, opts);
+                return *this;
+            }
+        };
+
+        /*
+        * maps code points to declaration ids.
+        * ASCII has its own direct table, so a lookup is just one load. anything
+        * else (i.e., a UTF-8 encoded "-e" with an accent) goes through a small hash map, which is
+        * never touched as long as only ASCII options are declared and passed.
+        */
+        class CharIndex
+        {
+            private:
+                std::array<uint32_t, 128> m_ascii;
+                std::unordered_map<uint32_t, uint32_t> m_other;
+
+            public:
+                CharIndex()
+                {
+                    m_ascii.fill(npos);
+                }
+
+                /*
+                * registers $decl for $cp.
+                * the first declaration wins, just like it did when declarations
+                * were searched linearly.
+                */
+                inline void put(uint32_t cp, uint32_t decl)
+                {
+                    if(cp < m_ascii.size())
+                    {
+                        if(m_ascii[cp] == npos)
+                        {
+                            m_ascii[cp] = decl;
+                        }
+                    }
+                    else
+                    {
+                        m_other.emplace(cp, decl);
+                    }
+                }
+
+                // returns the id of the declaration registered for $cp, or npos.
+                inline uint32_t get(uint32_t cp) const
+                {
+                    if(cp < m_ascii.size())
+                    {
+                        return m_ascii[cp];
+                    }
+                    if(m_other.empty())
+                    {
+                        return npos;
+                    }
+                    auto it = m_other.find(cp);
+                    if(it == m_other.end())
+                    {
+                        return npos;
+                    }
+                    return it->second;
+                }
+
+                inline void compact()
+                {
+                    m_other.rehash(0);
+                }
+
+                void write(SchemaWriter& w) const
+                {
+                    std::vector<uint32_t> other;
+                    for(auto iter=m_other.begin(); iter!=m_other.end(); iter++)
+                    {
+                        other.push_back(iter->first);
+                        other.push_back(iter->second);
+                    }
+                    w.array(m_ascii.data(), m_ascii.size());
+                    w.array(other.data(), other.size());
+                }
+
+                void read(SchemaReader& r, size_t ndecls)
+                {
+                    size_t i;
+                    size_t count;
+                    const uint32_t* tbl;
+                    tbl = r.template array<uint32_t>(count);
+                    r.expect(count == m_ascii.size());
+                    std::memcpy(m_ascii.data(), tbl, count * sizeof(uint32_t));
+                    for(i=0; i<count; i++)
+                    {
+                        r.expect((m_ascii[i] == npos) || (m_ascii[i] < ndecls));
+                    }
+                    tbl = r.template array<uint32_t>(count);
+                    r.expect((count % 2) == 0);
+                    m_other.clear();
+                    for(i=0; i<count; i+=2)
+                    {
+                        r.expect(tbl[i + 1] < ndecls);
+                        m_other.emplace(tbl[i], tbl[i + 1]);
+                    }
+                }
+        };
+
+        /*
+        * tells, by the first character of an option name (the one right after the dash, or
+        * dashes), which kinds of lookup could possibly succeed for it. it is, in effect, the
+        * first state of an automaton over all declared names: continueparse() consults it once
+        * per argument, and skips every lookup that is bound to fail - "-abc" goes straight
+        * to the short options, unless a family, numeric option, or LLVM style long
+        * option could start with 'a'.
+        */
+        class DispatchTable
+        {
+            public:
+                enum Flags: uint8_t
+                {
+                    // a long option (or, for a negatable one, "no-<name>") starts with the character
+                    DISPATCH_LONG = (1 << 0),
+
+                    // a family declared as "-<c>..."
+                    DISPATCH_FAMILY = (1 << 1),
+
+                    // a family declared as "--<c>..." (or "--*")
+                    DISPATCH_LONGFAMILY = (1 << 2),
+
+                    // a numeric family "-<c>", or, for digits, the bare "-"
+                    DISPATCH_NUMERIC = (1 << 3),
+                };
+
+            private:
+                std::array<uint8_t, 128> m_ascii;
+
+                // flags of anything beyond ASCII, all lumped together
+                uint8_t m_other;
+
+            public:
+                DispatchTable(): m_other(0)
+                {
+                    m_ascii.fill(0);
+                }
+
+                inline void mark(CharT c, uint8_t flags)
+                {
+                    using UCharT = typename std::make_unsigned<CharT>::type;
+                    if(UCharT(c) < m_ascii.size())
+                    {
+                        m_ascii[UCharT(c)] |= flags;
+                    }
+                    else
+                    {
+                        m_other |= flags;
+                    }
+                }
+
+                // marks every character with $flags.
+                inline void markAll(uint8_t flags)
+                {
+                    size_t i;
+                    for(i=0; i<m_ascii.size(); i++)
+                    {
+                        m_ascii[i] |= flags;
+                    }
+                    m_other |= flags;
+                }
+
+                inline uint8_t get(CharT c) const
+                {
+                    using UCharT = typename std::make_unsigned<CharT>::type;
+                    return ((UCharT(c) < m_ascii.size()) ? m_ascii[UCharT(c)] : m_other);
+                }
+
+                void write(SchemaWriter& w) const
+                {
+                    w.array(m_ascii.data(), m_ascii.size());
+                    w.value(m_other);
+                }
+
+                void read(SchemaReader& r)
+                {
+                    size_t count;
+                    const uint8_t* tbl;
+                    tbl = r.template array<uint8_t>(count);
+                    r.expect(count == m_ascii.size());
+                    std::memcpy(m_ascii.data(), tbl, count);
+                    m_other = r.template value<uint8_t>();
+                }
+        };
+
+        /*
+        * ASCII case-folding table, used for DOS options, which are case-insensitive.
+        * anything outside of ASCII is left as-is.
+        */
+        static constexpr std::array<unsigned char, 128> foldtable = []
+        {
+            size_t i = 0;
+            std::array<unsigned char, 128> tbl = {};
+            for(i=0; i<tbl.size(); i++)
+            {
+                tbl[i] = (((i >= 'A') && (i <= 'Z')) ? (i + ('a' - 'A')) : i);
+            }
+            return tbl;
+        }();
+
+        static constexpr CharT foldchar(CharT c)
+        {
+            using UCharT = typename std::make_unsigned<CharT>::type;
+            return ((UCharT(c) < foldtable.size()) ? CharT(foldtable[UCharT(c)]) : c);
+        }
+
+        /*
+        * open-addressing hash table, mapping long option names to declaration ids.
+        * names are not copied, but referenced by their offset in Schema::nametable, which
+        * is passed to every call.
+        * each slot keeps the precomputed hash of its name, so probing only ever
+        * compares strings whose hashes already match, and growing the table
+        * does not need to rehash any names.
+        * if $CaseFold is true, names are hashed and compared through foldchar().
+        */
+        template<bool CaseFold>
+        class NameIndex
+        {
+            public:
+                struct Slot
+                {
+                    size_t hash = 0;
+                    uint32_t offset = 0;
+                    uint32_t length = 0;
+                    uint32_t decl = npos;
+
+                    // always zero: spells out the padding, so that save() writes no stray bytes
+                    uint32_t unused = 0;
+                };
+
+            private:
+                std::vector<Slot> m_slots;
+                size_t m_count = 0;
+
+            private:
+                void grow()
+                {
+                    size_t i;
+                    size_t pos;
+                    size_t mask;
+                    std::vector<Slot> old;
+                    old.swap(m_slots);
+                    m_slots.resize((old.size() == 0) ? 16 : (old.size() * 2));
+                    mask = (m_slots.size() - 1);
+                    for(i=0; i<old.size(); i++)
+                    {
+                        if(old[i].decl != npos)
+                        {
+                            pos = (old[i].hash & mask);
+                            while(m_slots[pos].decl != npos)
+                            {
+                                pos = ((pos + 1) & mask);
+                            }
+                            m_slots[pos] = old[i];
+                        }
+                    }
+                }
+
+                static inline CharT fold(CharT c)
+                {
+                    if constexpr(CaseFold)
+                    {
+                        return foldchar(c);
+                    }
+                    else
+                    {
+                        return c;
+                    }
+                }
+
+                static inline bool equal(const CharT* a, const CharT* b, size_t len)
+                {
+                    size_t i;
+                    if constexpr(!CaseFold)
+                    {
+                        return (std::char_traits<CharT>::compare(a, b, len) == 0);
+                    }
+                    for(i=0; i<len; i++)
+                    {
+                        if(fold(a[i]) != fold(b[i]))
+                        {
+                            return false;
+                        }
+                    }
+                    return true;
+                }
+
+            public:
+                // FNV-1a, over (folded) code units
+                static inline size_t hashof(const CharT* str, size_t len)
+                {
+                    size_t i;
+                    uint64_t h;
+                    h = 14695981039346656037ull;
+                    for(i=0; i<len; i++)
+                    {
+                        h ^= uint64_t(typename std::make_unsigned<CharT>::type(fold(str[i])));
+                        h *= 1099511628211ull;
+                    }
+                    return size_t(h);
+                }
+
+                /*
+                * returns the declaration id registered for $str, or npos.
+                */
+                inline uint32_t find(const CharT* table, const CharT* str, size_t len) const
+                {
+                    size_t h;
+                    size_t pos;
+                    size_t mask;
+                    if(m_count == 0)
+                    {
+                        return npos;
+                    }
+                    h = hashof(str, len);
+                    mask = (m_slots.size() - 1);
+                    pos = (h & mask);
+                    while(m_slots[pos].decl != npos)
+                    {
+                        const Slot& slot = m_slots[pos];
+                        if((slot.hash == h) && (slot.length == len) && equal(table + slot.offset, str, len))
+                        {
+                            return slot.decl;
+                        }
+                        pos = ((pos + 1) & mask);
+                    }
+                    return npos;
+                }
+
+                /*
+                * registers the name at $offset in $table for $decl. if the name is already
+                * registered, nothing is changed, and false is returned - the first declaration wins.
+                */
+                bool insert(const CharT* table, uint32_t offset, uint32_t length, uint32_t decl)
+                {
+                    size_t h;
+                    size_t pos;
+                    size_t mask;
+                    if(find(table, table + offset, length) != npos)
+                    {
+                        return false;
+                    }
+                    // keep load factor at or below 1/2
+                    if(((m_count + 1) * 2) > m_slots.size())
+                    {
+                        grow();
+                    }
+                    h = hashof(table + offset, length);
+                    mask = (m_slots.size() - 1);
+                    pos = (h & mask);
+                    while(m_slots[pos].decl != npos)
+                    {
+                        pos = ((pos + 1) & mask);
+                    }
+                    m_slots[pos].hash = h;
+                    m_slots[pos].offset = offset;
+                    m_slots[pos].length = length;
+                    m_slots[pos].decl = decl;
+                    m_count++;
+                    return true;
+                }
+
+                inline size_t size() const
+                {
+                    return m_count;
+                }
+
+                void write(SchemaWriter& w) const
+                {
+                    w.array(m_slots.data(), m_slots.size());
+                }
+
+                // the slots are taken as-is, so no name is hashed again.
+                void read(SchemaReader& r, size_t ndecls, size_t tablelen)
+                {
+                    size_t i;
+                    r.array(m_slots);
+                    r.expect((m_slots.size() & (m_slots.size() - 1)) == 0);
+                    m_count = 0;
+                    for(i=0; i<m_slots.size(); i++)
+                    {
+                        if(m_slots[i].decl != npos)
+                        {
+                            r.expect(m_slots[i].decl < ndecls);
+                            r.expect(m_slots[i].offset <= tablelen);
+                            r.expect(m_slots[i].length <= (tablelen - m_slots[i].offset));
+                            m_count++;
+                        }
+                    }
+                    // find() relies on at least one free slot
+                    r.expect((m_count == 0) || (m_count < m_slots.size()));
+                }
+        };
+
+        /*
+        * a compact prefix trie over long option names, used to resolve abbreviated
+        * long options (i.e., "--verb" for "--verbose").
+        * every node knows whether all names below it belong to the same declaration, so
+        * resolving a prefix is a walk of length(prefix) nodes, regardless of how many
+        * options were declared. children are kept as a sorted sibling list.
+        */
+        class PrefixTrie
+        {
+            public:
+                /*
+                * laid out without any padding (whatever the size of CharT), since nodes
+                * are saved as they are.
+                */
+                struct Node
+                {
+                    // index of first child, and next sibling. 0 means none, since 0 is the root.
+                    uint32_t firstchild = 0;
+                    uint32_t nextsibling = 0;
+
+                    // id of the declaration of the name ending at this node (first one wins)
+                    uint32_t termdecl = npos;
+
+                    // id of the declaration all names below this node belong to (unless ambiguous)
+                    uint32_t decl = npos;
+
+                    // the code unit of this node, as unsigned value (see unit())
+                    uint32_t ch = 0;
+
+                    // true if a name ends at this node
+                    bool terminal = false;
+
+                    // true if names below this node belong to more than one declaration
+                    bool ambiguous = false;
+
+                    // always zero
+                    uint8_t unused[2] = {};
+                };
+
+            private:
+                std::vector<Node> m_nodes;
+
+            private:
+                // $c as stored in Node::ch; siblings are sorted by it.
+                static inline uint32_t unit(CharT c)
+                {
+                    return uint32_t(typename std::make_unsigned<CharT>::type(c));
+                }
+
+                inline uint32_t child(uint32_t n, CharT c) const
+                {
+                    uint32_t i;
+                    for(i=m_nodes[n].firstchild; i!=0; i=m_nodes[i].nextsibling)
+                    {
+                        if(m_nodes[i].ch == unit(c))
+                        {
+                            return i;
+                        }
+                        if(m_nodes[i].ch > unit(c))
+                        {
+                            break;
+                        }
+                    }
+                    return 0;
+                }
+
+                uint32_t addchild(uint32_t n, CharT c)
+                {
+                    uint32_t i;
+                    uint32_t prev;
+                    uint32_t idx;
+                    prev = 0;
+                    for(i=m_nodes[n].firstchild; (i != 0) && (m_nodes[i].ch < unit(c)); i=m_nodes[i].nextsibling)
+                    {
+                        prev = i;
+                    }
+                    if((i != 0) && (m_nodes[i].ch == unit(c)))
+                    {
+                        return i;
+                    }
+                    idx = uint32_t(m_nodes.size());
+                    m_nodes.emplace_back();
+                    m_nodes[idx].ch = unit(c);
+                    m_nodes[idx].nextsibling = i;
+                    if(prev == 0)
+                    {
+                        m_nodes[n].firstchild = idx;
+                    }
+                    else
+                    {
+                        m_nodes[prev].nextsibling = idx;
+                    }
+                    return idx;
+                }
+
+            public:
+                PrefixTrie(): m_nodes(1)
+                {
+                }
+
+                inline bool empty() const
+                {
+                    return (m_nodes[0].firstchild == 0);
+                }
+
+                inline void compact()
+                {
+                    m_nodes.shrink_to_fit();
+                }
+
+                void write(SchemaWriter& w) const
+                {
+                    w.array(m_nodes.data(), m_nodes.size());
+                }
+
+                /*
+                * besides checking bounds, makes sure the nodes form a tree: no node is linked
+                * to twice, the root not at all, and every node can be reached from the root.
+                * so no walk over a corrupt file can loop forever.
+                */
+                void read(SchemaReader& r, size_t ndecls)
+                {
+                    size_t i;
+                    size_t reached;
+                    uint32_t n;
+                    std::vector<uint8_t> linked;
+                    std::vector<uint32_t> pending;
+                    r.array(m_nodes);
+                    r.expect(m_nodes.size() > 0);
+                    linked.resize(m_nodes.size());
+                    for(i=0; i<m_nodes.size(); i++)
+                    {
+                        const Node& node = m_nodes[i];
+                        r.expect((node.firstchild < m_nodes.size()) && (node.nextsibling < m_nodes.size()));
+                        r.expect((node.decl == npos) || (node.decl < ndecls));
+                        r.expect((node.termdecl == npos) || (node.termdecl < ndecls));
+                        // children always come after their parent
+                        r.expect((node.firstchild == 0) || (node.firstchild > i));
+                        // the root has no siblings
+                        r.expect((i != 0) || (node.nextsibling == 0));
+                        if(node.firstchild != 0)
+                        {
+                            r.expect(!linked[node.firstchild]);
+                            linked[node.firstchild] = 1;
+                        }
+                        if(node.nextsibling != 0)
+                        {
+                            r.expect(!linked[node.nextsibling]);
+                            linked[node.nextsibling] = 1;
+                        }
+                    }
+                    reached = 0;
+                    pending.push_back(0);
+                    while(!pending.empty())
+                    {
+                        n = pending.back();
+                        pending.pop_back();
+                        reached++;
+                        if(m_nodes[n].firstchild != 0)
+                        {
+                            pending.push_back(m_nodes[n].firstchild);
+                        }
+                        if(m_nodes[n].nextsibling != 0)
+                        {
+                            pending.push_back(m_nodes[n].nextsibling);
+                        }
+                    }
+                    r.expect(reached == m_nodes.size());
+                }
+
+                void insert(const CharT* name, size_t len, uint32_t decl)
+                {
+                    size_t i;
+                    uint32_t n;
+                    n = 0;
+                    for(i=0; i<len; i++)
+                    {
+                        n = addchild(n, name[i]);
+                        Node& node = m_nodes[n];
+                        if(node.decl == npos)
+                        {
+                            node.decl = decl;
+                        }
+                        else if(node.decl != decl)
+                        {
+                            node.ambiguous = true;
+                        }
+                    }
+                    if(!m_nodes[n].terminal)
+                    {
+                        m_nodes[n].terminal = true;
+                        m_nodes[n].termdecl = decl;
+                    }
+                }
+
+                /*
+                * returns the node reached by walking $str, or NULL, if no
+                * name starts with $str.
+                */
+                inline const Node* walk(const CharT* str, size_t len) const
+                {
+                    size_t i;
+                    uint32_t n;
+                    n = 0;
+                    for(i=0; i<len; i++)
+                    {
+                        n = child(n, str[i]);
+                        if(n == 0)
+                        {
+                            return nullptr;
+                        }
+                    }
+                    return ((n == 0) ? nullptr : &m_nodes[n]);
+                }
+
+                /*
+                * returns the id of the declaration of the longest name that $str starts with,
+                * storing the length of that name in $matchlen, or npos if there is none.
+                */
+                inline uint32_t longest(const CharT* str, size_t len, size_t& matchlen) const
+                {
+                    size_t i;
+                    uint32_t n;
+                    uint32_t best;
+                    n = 0;
+                    best = npos;
+                    for(i=0; i<len; i++)
+                    {
+                        n = child(n, str[i]);
+                        if(n == 0)
+                        {
+                            break;
+                        }
+                        if(m_nodes[n].terminal)
+                        {
+                            best = m_nodes[n].termdecl;
+                            matchlen = (i + 1);
+                        }
+                    }
+                    return best;
+                }
+
+                /*
+                * appends every name below $node to $dest, each prefixed with $prefix.
+                */
+                void collect(const Node* node, string& prefix, std::vector<string>& dest) const
+                {
+                    uint32_t i;
+                    if(node->terminal)
+                    {
+                        dest.push_back(prefix);
+                    }
+                    for(i=node->firstchild; i!=0; i=m_nodes[i].nextsibling)
+                    {
+                        prefix.push_back(CharT(m_nodes[i].ch));
+                        collect(&m_nodes[i], prefix, dest);
+                        prefix.pop_back();
+                    }
+                }
+        };
+
+        /*
+        * compile-time option declarations.
+        * an array of StaticOption uses the exact same syntax as on(), i.e.:
+        *
+        *   static constexpr OptionParser::StaticOption myoptions[] =
+        *   {
+        *       {{"-v", "--verbose"}, "increase verbosity"},
+        *       {{"-o<file>", "--out=<file>"}, "set output file"},
+        *   };
+        *
+        * which is turned into a StaticSchema by compileSchema() at compile time.
+        * see BasicStaticOptionParser for how to use it.
+        */
+        struct StaticOption
+        {
+            static constexpr size_t maxpatterns = 8;
+
+            // the option syntaxes, like {"-o?", "--out=?"}. unused entries are NULL.
+            const CharT* patterns[maxpatterns];
+
+            // the description, used by help()
+            const CharT* description;
+        };
+
+        // a parsed StaticOption.
+        struct StaticDecl
+        {
+            bool needvalue = false;
+            bool hasplaceholder = false;
+            std::basic_string_view<CharT> placeholder;
+            std::basic_string_view<CharT> description;
+        };
+
+        // a single short or long name of a StaticDecl.
+        struct StaticName
+        {
+            std::basic_string_view<CharT> name;
+            size_t decl = 0;
+            bool isgnu = true;
+        };
+
+        /*
+        * a perfect hash over $NumKeys distinct 64bit key hashes, built at compile time
+        * using hash-and-displace: keys are first distributed into buckets, then every
+        * bucket (largest first) gets a seed that places all of its keys into free slots.
+        * a lookup is thus two multiply-mixes of the key hash, and one load.
+        * it only ever tells *where* a key would be; the caller must still compare
+        * the actual key.
+        */
+        template<size_t NumKeys>
+        struct StaticPerfectHash
+        {
+            static constexpr size_t npos = size_t(-1);
+            static constexpr size_t maxseed = 1u << 16;
+
+            static constexpr size_t pow2ceil(size_t n)
+            {
+                size_t r = 0;
+                r = 1;
+                while(r < n)
+                {
+                    r <<= 1;
+                }
+                return r;
+            }
+
+            static constexpr size_t tablesize = pow2ceil(NumKeys * 2);
+            static constexpr size_t bucketcount = pow2ceil((NumKeys / 4) + 1);
+
+            static constexpr uint64_t mix(uint64_t h, uint64_t seed)
+            {
+                uint64_t x = 0;
+                x = (h ^ (seed * 0x9E3779B97F4A7C15ull));
+                x ^= (x >> 33);
+                x *= 0xff51afd7ed558ccdull;
+                x ^= (x >> 33);
+                x *= 0xc4ceb9fe1a85ec53ull;
+                x ^= (x >> 33);
+                return x;
+            }
+
+            // per-bucket seed
+            std::array<uint32_t, bucketcount> seeds = {};
+
+            // key index + 1, or 0 if empty
+            std::array<uint32_t, tablesize> slots = {};
+
+            constexpr void build(const std::array<uint64_t, NumKeys>& keys)
+            {
+                size_t i = 0;
+                size_t j = 0;
+                size_t b = 0;
+                size_t n = 0;
+                size_t cnt = 0;
+                size_t size = 0;
+                size_t maxsize = 0;
+                uint32_t seed = 0;
+                bool ok = false;
+                std::array<size_t, bucketcount> bsize = {};
+                std::array<size_t, NumKeys> bkeys = {};
+                std::array<size_t, NumKeys> bslots = {};
+                maxsize = 0;
+                for(i=0; i<NumKeys; i++)
+                {
+                    for(j=0; j<i; j++)
+                    {
+                        static_require(keys[i] != keys[j], "duplicate option name in static schema");
+                    }
+                    b = (mix(keys[i], 0) & (bucketcount - 1));
+                    bsize[b]++;
+                    if(bsize[b] > maxsize)
+                    {
+                        maxsize = bsize[b];
+                    }
+                }
+                for(size=maxsize; size>0; size--)
+                {
+                    for(b=0; b<bucketcount; b++)
+                    {
+                        if(bsize[b] != size)
+                        {
+                            continue;
+                        }
+                        n = 0;
+                        for(i=0; i<NumKeys; i++)
+                        {
+                            if((mix(keys[i], 0) & (bucketcount - 1)) == b)
+                            {
+                                bkeys[n++] = i;
+                            }
+                        }
+                        ok = false;
+                        for(seed=1; (seed < maxseed) && !ok; seed++)
+                        {
+                            ok = true;
+                            for(cnt=0; (cnt < n) && ok; cnt++)
+                            {
+                                bslots[cnt] = (mix(keys[bkeys[cnt]], seed) & (tablesize - 1));
+                                if(slots[bslots[cnt]] != 0)
+                                {
+                                    ok = false;
+                                }
+                                for(j=0; (j < cnt) && ok; j++)
+                                {
+                                    if(bslots[j] == bslots[cnt])
+                                    {
+                                        ok = false;
+                                    }
+                                }
+                            }
+                            if(ok)
+                            {
+                                seeds[b] = seed;
+                                for(cnt=0; cnt<n; cnt++)
+                                {
+                                    slots[bslots[cnt]] = uint32_t(bkeys[cnt] + 1);
+                                }
+                            }
+                        }
+                        static_require(ok, "failed to build perfect hash for static schema");
+                    }
+                }
+            }
+
+            // returns the index of the key that *might* be $h, or npos.
+            constexpr size_t find(uint64_t h) const
+            {
+                uint32_t seed = 0;
+                uint32_t idx = 0;
+                if constexpr(NumKeys == 0)
+                {
+                    (void)h;
+                    return npos;
+                }
+                else
+                {
+                    seed = seeds[mix(h, 0) & (bucketcount - 1)];
+                    idx = slots[mix(h, seed) & (tablesize - 1)];
+                    return ((idx == 0) ? npos : size_t(idx - 1));
+                }
+            }
+        };
+
+        /*
+        * the compiled form of an array of StaticOption. produced by compileSchema().
+        */
+        template<size_t NumDecls, size_t NumShort, size_t NumLong>
+        struct StaticSchema
+        {
+            static constexpr size_t npos = size_t(-1);
+            static constexpr size_t declcount = NumDecls;
+
+            std::array<StaticDecl, NumDecls> decls = {};
+            std::array<StaticName, NumShort> shortnames = {};
+            std::array<StaticName, NumLong> longnames = {};
+            StaticPerfectHash<NumShort> shorthash = {};
+            StaticPerfectHash<NumLong> longhash = {};
+
+            // returns the index of the declaration for short option $c, or npos.
+            constexpr size_t find_short(CharT c) const
+            {
+                size_t idx = 0;
+                idx = shorthash.find(static_hashchar(c));
+                if((idx != npos) && (shortnames[idx].name[0] == c))
+                {
+                    return shortnames[idx].decl;
+                }
+                return npos;
+            }
+
+            // returns the index of the declaration for long option $str, or npos.
+            constexpr size_t find_long(const CharT* str, size_t len) const
+            {
+                size_t idx = 0;
+                idx = longhash.find(static_hashstr(str, len));
+                if((idx != npos) && longnames[idx].isgnu && (longnames[idx].name == std::basic_string_view<CharT>(str, len)))
+                {
+                    return longnames[idx].decl;
+                }
+                return npos;
+            }
+
+            // returns the index of the declaration for DOS option $str (ignoring case), or npos.
+            constexpr size_t find_dos(const CharT* str, size_t len) const
+            {
+                size_t i = 0;
+                size_t idx = 0;
+                idx = longhash.find(static_hashdos(str, len));
+                if((idx == npos) || longnames[idx].isgnu || (longnames[idx].name.size() != len))
+                {
+                    return npos;
+                }
+                for(i=0; i<len; i++)
+                {
+                    if(foldchar(longnames[idx].name[i]) != foldchar(str[i]))
+                    {
+                        return npos;
+                    }
+                }
+                return longnames[idx].decl;
+            }
+        };
+
+        /*
+        * the lookups of a StaticSchema, as plain functions, so that parsers can use
+        * them without knowing the type of the schema. each returns the index of the
+        * option in the schema, or npos. see BasicStaticOptionParser.
+        */
+        struct StaticLookup
+        {
+            size_t (*find_short)(CharT c);
+            size_t (*find_long)(const CharT* str, size_t len);
+            size_t (*find_dos)(const CharT* str, size_t len);
+        };
+
+        /*
+        * raises a declaration error while evaluating a static schema if $ok is false.
+        * since throwing is not a constant expression, this turns the error into a
+        * compile error, with $msg showing up in the diagnostic.
+        */
+        static constexpr void static_require(bool ok, const char* msg)
+        {
+            if(!ok)
+            {
+                throw std::logic_error(msg);
+            }
+        }
+
+        static constexpr uint64_t static_hashstr(const CharT* str, size_t len)
+        {
+            size_t i = 0;
+            uint64_t h = 0;
+            h = 14695981039346656037ull;
+            for(i=0; i<len; i++)
+            {
+                h ^= uint64_t(typename std::make_unsigned<CharT>::type(str[i]));
+                h *= 1099511628211ull;
+            }
+            return h;
+        }
+
+        /*
+        * hash of a DOS option name: folded, and prefixed with '/', so that the keys
+        * of "--foo" and "/foo" differ in the perfect hash of a schema.
+        */
+        static constexpr uint64_t static_hashdos(const CharT* str, size_t len)
+        {
+            size_t i = 0;
+            uint64_t h = 0;
+            h = 14695981039346656037ull;
+            h ^= uint64_t('/');
+            h *= 1099511628211ull;
+            for(i=0; i<len; i++)
+            {
+                h ^= uint64_t(typename std::make_unsigned<CharT>::type(foldchar(str[i])));
+                h *= 1099511628211ull;
+            }
+            return h;
+        }
+
+        static constexpr uint64_t static_hashchar(CharT c)
+        {
+            return uint64_t(typename std::make_unsigned<CharT>::type(c));
+        }
+
+        // constexpr-friendly variant of isalphanum(). ASCII only.
+        static constexpr bool static_isalphanum(CharT c)
+        {
+            return (
+                ((c >= 'a') && (c <= 'z')) ||
+                ((c >= 'A') && (c <= 'Z')) ||
+                ((c >= '0') && (c <= '9')) ||
+                (c == '?') || (c == '!') || (c == '#')
+            );
+        }
+
+        static constexpr bool static_islong(std::basic_string_view<CharT> pat)
+        {
+            return (
+                ((pat.size() > 2) && (pat[0] == '-') && (pat[1] == '-')) ||
+                ((pat.size() > 1) && (pat[0] == '/') && static_isalphanum(pat[1]))
+            );
+        }
+
+        static constexpr size_t static_countnames(const StaticOption& opt, bool wantlong)
+        {
+            size_t j = 0;
+            size_t cnt = 0;
+            cnt = 0;
+            for(j=0; (j < StaticOption::maxpatterns) && (opt.patterns[j] != nullptr); j++)
+            {
+                if(static_islong(opt.patterns[j]) == wantlong)
+                {
+                    cnt++;
+                }
+            }
+            return cnt;
+        }
+
+        template<size_t NumOpts>
+        static constexpr size_t static_countnames(const StaticOption (&opts)[NumOpts], bool wantlong)
+        {
+            size_t i = 0;
+            size_t cnt = 0;
+            cnt = 0;
+            for(i=0; i<NumOpts; i++)
+            {
+                cnt += static_countnames(opts[i], wantlong);
+            }
+            return cnt;
+        }
+
+        /*
+        * true if one of $opts declares the GNU long option $name, or (if $name is a
+        * single character) the short option $name.
+        */
+        template<size_t NumOpts>
+        static constexpr bool static_declares(const StaticOption (&opts)[NumOpts], std::basic_string_view<CharT> name)
+        {
+            size_t i = 0;
+            size_t j = 0;
+            std::basic_string_view<CharT> pat = {};
+            for(i=0; i<NumOpts; i++)
+            {
+                for(j=0; (j < StaticOption::maxpatterns) && (opts[i].patterns[j] != nullptr); j++)
+                {
+                    pat = opts[i].patterns[j];
+                    if(static_islong(pat))
+                    {
+                        if((pat[0] == '-') && (pat.substr(2, pat.find('=') - 2) == name))
+                        {
+                            return true;
+                        }
+                    }
+                    else if((name.size() == 1) && (pat.size() > 1) && (pat[0] == '-') && (pat[1] == name[0]))
+                    {
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+        /*
+        * the static counterpart of the "-h" and "--help" that init() declares, minus
+        * any name $opts declares itself - those keep their own meaning.
+        */
+        template<size_t NumOpts>
+        static constexpr StaticOption static_helpoption(const StaticOption (&opts)[NumOpts])
+        {
+            size_t j = 0;
+            StaticOption opt = {};
+            opt.description = "show this help";
+            if(!static_declares(opts, "h"))
+            {
+                opt.patterns[j++] = "-h";
+            }
+            if(!static_declares(opts, "help"))
+            {
+                opt.patterns[j++] = "--help";
+            }
+            return opt;
+        }
+
+        /*
+        * compile-time counterpart of hasplaceholder(): if $pat ends in "<name>", store
+        * "name" in $dest, and the position of '<' in $ltpos.
+        */
+        static constexpr bool static_placeholder(std::basic_string_view<CharT> pat, std::basic_string_view<CharT>& dest, size_t& ltpos)
+        {
+            if(pat[pat.size() - 1] == '>')
+            {
+                ltpos = pat.find('<');
+                if(ltpos != std::basic_string_view<CharT>::npos)
+                {
+                    dest = pat.substr(ltpos + 1, pat.size() - ltpos - 2);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /*
+        * compile the array $Options into a StaticSchema, using the same grammar
+        * as addDeclaration(). anything addDeclaration() would throw an Error for
+        * is a compile error here. additionally, declaring the same name twice is
+        * an error as well (addDeclaration() lets the first declaration win).
+        * the help option comes first, so option $i of $Options is option $i+1 of
+        * the schema. see static_helpoption().
+        */
+        template<const auto& Options>
+        static constexpr auto compileSchema()
+        {
+            using StrView = std::basic_string_view<CharT>;
+            constexpr size_t ndecls = std::size(Options) + 1;
+            constexpr size_t nshort = static_countnames(Options, false) + static_countnames(static_helpoption(Options), false);
+            constexpr size_t nlong = static_countnames(Options, true) + static_countnames(static_helpoption(Options), true);
+            size_t i = 0;
+            size_t j = 0;
+            size_t ishort = 0;
+            size_t ilong = 0;
+            size_t ltpos = 0;
+            bool hph = false;
+            bool hadlong = false;
+            bool hadshort = false;
+            bool longwant = false;
+            bool shortwant = false;
+            StrView pat = {};
+            StrView placeholder = {};
+            StaticOption helpopt = {};
+            StaticSchema<ndecls, nshort, nlong> schema = {};
+            std::array<uint64_t, nshort> shortkeys = {};
+            std::array<uint64_t, nlong> longkeys = {};
+            ishort = 0;
+            ilong = 0;
+            helpopt = static_helpoption(Options);
+            for(i=0; i<ndecls; i++)
+            {
+                StaticDecl& decl = schema.decls[i];
+                const StaticOption& opt = ((i == 0) ? helpopt : Options[i - 1]);
+                hadlong = false;
+                hadshort = false;
+                longwant = false;
+                shortwant = false;
+                decl.description = StrView(opt.description);
+                for(j=0; (j < StaticOption::maxpatterns) && (opt.patterns[j] != nullptr); j++)
+                {
+                    pat = opt.patterns[j];
+                    hph = false;
+                    static_require(pat[pat.size() - 1] != '*', "prefix families are not supported in static schemas");
+                    if(static_islong(pat))
+                    {
+                        StaticName& nm = schema.longnames[ilong];
+                        hadlong = true;
+                        nm.decl = i;
+                        nm.isgnu = (pat[0] == '-');
+                        if(static_placeholder(pat, placeholder, ltpos))
+                        {
+                            hph = true;
+                            longwant = true;
+                            static_require((ltpos > 2) && (pat[ltpos - 1] == (nm.isgnu ? '=' : ':')), "malformed placeholder in long option");
+                            nm.name = pat.substr(nm.isgnu ? 2 : 1, ltpos - (nm.isgnu ? 3 : 2));
+                        }
+                        else if((pat.size() > 2) && (pat[pat.size() - 1] == '?') && (pat[pat.size() - 2] == (nm.isgnu ? '=' : ':')))
+                        {
+                            longwant = true;
+                            nm.name = pat.substr(nm.isgnu ? 2 : 1, pat.size() - (nm.isgnu ? 4 : 3));
+                        }
+                        else
+                        {
+                            longwant = false;
+                            nm.name = pat.substr(nm.isgnu ? 2 : 1);
+                        }
+                        static_require(nm.name.size() > 0, "empty long option name");
+                        if(nm.isgnu)
+                        {
+                            longkeys[ilong] = static_hashstr(nm.name.data(), nm.name.size());
+                        }
+                        else
+                        {
+                            longkeys[ilong] = static_hashdos(nm.name.data(), nm.name.size());
+                        }
+                        ilong++;
+                    }
+                    else if((pat.size() > 1) && (pat[0] == '-') && static_isalphanum(pat[1]))
+                    {
+                        StaticName& nm = schema.shortnames[ishort];
+                        hadshort = true;
+                        nm.decl = i;
+                        nm.name = pat.substr(1, 1);
+                        // permits declaring '-?'
+                        shortwant = ((pat[pat.size() - 1] == '?') && (pat.size() > 2));
+                        if(static_placeholder(pat, placeholder, ltpos))
+                        {
+                            hph = true;
+                            shortwant = true;
+                        }
+                        shortkeys[ishort] = static_hashchar(pat[1]);
+                        ishort++;
+                    }
+                    else
+                    {
+                        static_require(false, "unparseable option syntax");
+                    }
+                    if(hph)
+                    {
+                        decl.hasplaceholder = true;
+                        decl.placeholder = placeholder;
+                    }
+                }
+                static_require(!(longwant && hadshort && !shortwant), "long option ended in '=?', but short option did not");
+                static_require(!(shortwant && hadlong && !longwant), "short option ended in '?', but long option did not");
+                decl.needvalue = (longwant || shortwant);
+            }
+            schema.shorthash.build(shortkeys);
+            schema.longhash.build(longkeys);
+            return schema;
+        }
+
+        /*
+        * big TODO: read options from a file, i.e.,
+        * if declaration is like on({"-v", "--verbose"}, ...), then
+        * FileParser would look for token "verbose", and process it as
+        * if passed on the command line.
+        * like a configuration file, basically.
+        * idea: add additional parameter to on() to explicitly specify
+        * configuration file variable name (i.e., on({"-v", "--verbose"}, "use-verbose", "...", []{...}))
+        */
+        class FileParser
+        {
+            public:
+            private:
+                std::istream* m_stream;
+                std::string m_filename;
+                bool m_mustclose;
+
+            private:
+                std::istream* openFile(const std::string& path)
+                {
+                    std::fstream* strm;
+                    strm = new std::fstream(path, std::ios::in | std::ios::binary);
+                    return strm;
+                }
+
+                void check()
+                {
+                    std::stringstream ss;
+                    if(!m_stream->good())
+                    {
+                        ss << "failed to open '" << m_filename << "' for reading";
+                        throw IOError(ss.str());
+                    }
+                }
+
+            public:
+                // allow using an already existing stream
+                // FileParser...(&alreadyexistingstream, "somefilename") ...
+                FileParser(std::istream* strm, const std::string& filename, bool mustclose=false):
+                    m_stream(strm), m_filename(filename), m_mustclose(mustclose)
+                {
+                    check();
+                }
+
+                FileParser(const std::string& path):
+                    FileParser(openFile(path), true)
+                {}
+
+                ~FileParser()
+                {
+                    if(m_mustclose)
+                    {
+                        delete m_stream;
+                    }
+                }
+        };
+
+        /*
+        * alphanumeric, or one of '?', '!', '#'.
+        * code units outside of ASCII are accepted as well, since they are part of
+        * a multibyte character; whether that is valid is up to decodechar().
+        * (std::isalnum() is neither meant for UTF-8, nor defined for negative chars.)
+        */
+        static inline bool isalphanum(CharT c)
+        {
+            return ((typename std::make_unsigned<CharT>::type(c) >= 0x80) || static_isalphanum(c));
+        }
+
+        /*
+        * returns $str[$i], or NUL if $i is past its end - like std::string would.
+        */
+        static inline CharT charat(string_view str, size_t i)
+        {
+            return ((i < str.size()) ? str[i] : CharT(0));
+        }
+
+        /*
+        * decodes the code point at $str (which has $len code units left), and stores
+        * the number of code units it took in $used.
+        * for single-byte CharT, that is UTF-8; ASCII takes a single compare, the rest
+        * is left to decodeutf8(). wider CharT are used as-is.
+        * invalid sequences yield badchar, with $used being 1.
+        */
+        static inline uint32_t decodechar(const CharT* str, size_t len, size_t& used)
+        {
+            using UCharT = typename std::make_unsigned<CharT>::type;
+            used = 1;
+            if constexpr(sizeof(CharT) == 1)
+            {
+                if(UCharT(str[0]) < 0x80)
+                {
+                    return UCharT(str[0]);
+                }
+                return decodeutf8(str, len, used);
+            }
+            else
+            {
+                (void)len;
+                return UCharT(str[0]);
+            }
+        }
+
+        /*
+        * validating UTF-8 decoder for anything that is not ASCII.
+        * rejects stray continuation bytes, overlong forms, surrogates, and anything
+        * above U+10FFFF.
+        */
+        static uint32_t decodeutf8(const CharT* str, size_t len, size_t& used)
+        {
+            size_t i;
+            size_t cnt;
+            uint32_t cp;
+            uint32_t lead;
+            uint32_t unit;
+            static constexpr uint32_t mincp[5] = {0, 0, 0x80, 0x800, 0x10000};
+            lead = (unsigned char)(str[0]);
+            used = 1;
+            // 0xC0 and 0xC1 could only ever start overlong forms
+            if((lead < 0xC2) || (lead > 0xF4))
+            {
+                return badchar;
+            }
+            cnt = ((lead < 0xE0) ? 2 : ((lead < 0xF0) ? 3 : 4));
+            if(len < cnt)
+            {
+                return badchar;
+            }
+            cp = (lead & (0x7F >> cnt));
+            for(i=1; i<cnt; i++)
+            {
+                unit = (unsigned char)(str[i]);
+                if((unit & 0xC0) != 0x80)
+                {
+                    return badchar;
+                }
+                cp = ((cp << 6) | (unit & 0x3F));
+            }
+            if((cp < mincp[cnt]) || (cp > 0x10FFFF) || ((cp >= 0xD800) && (cp <= 0xDFFF)))
+            {
+                return badchar;
+            }
+            used = cnt;
+            return cp;
+        }
+
+        // is it a valid long option?
+        static inline bool isvalidlongopt(const string& str)
+        {
+            return ((str[0] == '-') && (str[1] == '-'));
+        }
+
+        // is it a valid DOS-style option?
+        static inline bool isvaliddosopt(const string& str)
+        {
+            return ((str[0] == '/') && isalphanum(str[1]));
+        }
+
+    protected:
+        // the state of parse() calls without a ParseContext.
+        ParseContext m_ctx;
+
+        /*
+        * the subcommand parsers of parse() calls without a ParseContext, by command
+        * index. each one shares the schema of Command::parser, but has its own m_ctx,
+        * so that clones never see each other's subcommands. like m_ctx, these are
+        * only ever touched by parse() without a ParseContext, which creates them
+        * when first needed.
+        */
+        mutable std::vector<std::unique_ptr<BasicOptionParser>> m_commands;
+
+        /*
+        * a subcommand, declared by onCommand().
+        * $parser is only created (and populated by $factory) once $name is seen, or
+        * the schema is frozen (see commandParser()), and is then shared by every
+        * clone of the schema. it is only read while parsing; its state lives in
+        * ParseContext::m_command, or in m_commands.
+        */
+        struct Command
+        {
+            string name;
+            string description;
+            CommandFactory factory;
+            std::unique_ptr<BasicOptionParser> parser;
+        };
+
+        /*
+        * everything declared on a parser: declarations, names, lookup indexes,
+        * settings and help text - that is, anything that isn't specific to a single
+        * parse run.
+        * once frozen (see freeze()), it is never modified again.
+        */
+        struct Schema
+        {
+            // owns the declarations, and their description/placeholder strings.
+            Arena arena;
+
+            /*
+            * the declarations, indexed by their id. these only hold what help() and
+            * alias() need - anything needed for parsing is kept in the hot arrays below,
+            * which are indexed by the same id.
+            */
+            std::vector<Declaration*> declarations;
+
+            // hot: per-declaration flags (see DeclFlags)
+            std::vector<uint8_t> declflags;
+
+            // hot: per-declaration callbacks
+            std::vector<Callback> callbacks;
+
+            // every declared option name, back to back. referenced by NameRef.
+            string nametable;
+
+            // every declared option name, in order of declaration.
+            std::vector<NameRef> names;
+
+            // short option lookup table, mapping to declaration ids.
+            CharIndex shortindex;
+
+            /*
+            * numeric families (see onNumber()), keyed by the letter between dash and digits
+            * (i.e., 'O' for "-O3"). bare "-<digits>" uses numericbare instead.
+            */
+            CharIndex numericindex;
+
+            // the numeric family for bare "-<digits>", or npos.
+            uint32_t numericbare = npos;
+
+            // true, if onNumber() was used at all
+            bool numericdeclared = false;
+
+            // long option lookup table.
+            NameIndex<false> longindex;
+
+            // DOS option lookup table; case-insensitive.
+            NameIndex<true> dosindex;
+
+            // prefix index of all GNU long options; only populated if abbreviations are allowed.
+            PrefixTrie abbrevtrie;
+
+            // prefix families (i.e., "-W*"), resolved by longest match.
+            PrefixTrie familytrie;
+
+            // whether abbreviated long options are resolved. see allowAbbreviations().
+            bool allowabbrev = false;
+
+            // whether "-name" is resolved as long option. see allowSingleDashLong().
+            bool singledashlong = false;
+
+            // stop_if callbacks
+            std::vector<StopIfCallback> stopif_funcs;
+
+            // stop_if callbacks inspecting the ParseContext
+            std::vector<StopIfContextCallback> stopif_ctxfuncs;
+
+            // buffer for the banner (the text printed prior to the help text)
+            stringstream helpbanner;
+
+            // buffer for the tail (the text printed after the help text)
+            stringstream helptail;
+
+            // true, if any DOS style options had been declared.
+            // only meaningful in parse() - DOS options are usually ignored.
+            bool dosoptsdeclared = false;
+
+            // a handler for unknown/errornous options
+            UnknownOptCallback on_unknownoptfn;
+
+            // whether init() declared "-h"/"--help". passed on to subcommands.
+            bool declhelp = false;
+
+            // subcommands, in the order they were declared.
+            std::vector<Command> commands;
+
+            /*
+            * guards the creation of Command::parser: clones that share this schema may
+            * see the same command on different threads. not needed once frozen.
+            */
+            std::mutex commandlock;
+
+            // command names (interned in nametable) -> index in commands.
+            NameIndex<false> commandindex;
+
+            // set by freeze(). a frozen schema is read-only.
+            bool frozen = false;
+
+            // the complete help text, rendered by freeze().
+            string helptext;
+
+            /*
+            * the schema of the enclosing command, if this is the schema of a subcommand.
+            * only used by help(); options of enclosing commands are resolved through
+            * ParseContext::m_outer.
+            */
+            std::weak_ptr<const Schema> parent;
+
+            // the file a schema was loaded from (see load()); descriptions point into it.
+            std::shared_ptr<const MappedFile> backing;
+
+            // which lookups an argument may need, by the first character of its name.
+            DispatchTable dispatch;
+
+            // returns the name $ref as string.
+            inline string name_str(const NameRef& ref) const
+            {
+                return nametable.substr(ref.offset, ref.length);
+            }
+
+            // releases the spare capacity of every table. see freeze().
+            void compact()
+            {
+                declarations.shrink_to_fit();
+                declflags.shrink_to_fit();
+                callbacks.shrink_to_fit();
+                nametable.shrink_to_fit();
+                names.shrink_to_fit();
+                stopif_funcs.shrink_to_fit();
+                stopif_ctxfuncs.shrink_to_fit();
+                commands.shrink_to_fit();
+                shortindex.compact();
+                numericindex.compact();
+                abbrevtrie.compact();
+                familytrie.compact();
+            }
+        };
+
+        // the declarations etc. of this parser.
+        std::shared_ptr<Schema> m_schema;
+
+        // set by freeze(). unlike Schema::frozen, this is not shared with clones.
+        bool m_frozen = false;
+
+        // the lookups of the StaticSchema this parser was built from, if any. see addStaticDeclarations().
+        const StaticLookup* m_staticlookup = nullptr;
+
+    protected:
+        /*
+        * todo: more meaningful exception classes
         * this function is also meant as a wrapper for situations
         * where a C++ compiler doesn't allow exceptions (for any reason).
         * needs to be ifdef'd, for those cases.
         */
-        template<typename ExClass, typename... Args>
-        void throwError(Args&&... args)
+        template<typename ExClass, typename... Args>
+        static void throwError(Args&&... args)
+        {
+            string msg;
+            stringstream buf;
+            ((buf << args), ...);
+            msg = buf.str();
+            throw ExClass(msg);
+        }
+
+        /*
+        * must be called before anything in m_schema is modified.
+        * throws Error if the parser was frozen.
+        * if the schema is shared with a clone (or is the frozen schema of the parser
+        * this one was cloned from), this parser gets its own copy first.
+        */
+        inline void ensureMutable()
+        {
+            if(m_frozen)
+            {
+                throwError<Error>("parser is frozen; its declarations can no longer be changed");
+            }
+            if((m_schema.use_count() > 1) || m_schema->frozen)
+            {
+                detachSchema();
+            }
+        }
+
+        /*
+        * replaces m_schema with a copy that is owned by this parser alone.
+        * declarations are copied into the arena of the copy; callbacks, names and
+        * indexes are copied as they are, since they only refer to declarations by id.
+        * subcommand parsers are not copied - their factories create them again when
+        * needed (see commandParser()), for the copy to be their parent.
+        */
+        void detachSchema()
+        {
+            size_t i;
+            Declaration* decl;
+            std::shared_ptr<Schema> copy;
+            const Schema& old = *m_schema;
+            copy = std::make_shared<Schema>();
+            copy->declarations.reserve(old.declarations.size());
+            for(i=0; i<old.declarations.size(); i++)
+            {
+                decl = copy->arena.template make<Declaration>();
+                *decl = *old.declarations[i];
+                decl->description = copy->arena.intern(decl->description.data(), decl->description.size());
+                if(decl->placeholder.data() != defaultplaceholder)
+                {
+                    decl->placeholder = copy->arena.intern(decl->placeholder.data(), decl->placeholder.size());
+                }
+                decl->selfref = this;
+                decl->schema = copy.get();
+                copy->declarations.push_back(decl);
+            }
+            copy->declflags = old.declflags;
+            copy->callbacks = old.callbacks;
+            copy->nametable = old.nametable;
+            copy->names = old.names;
+            copy->shortindex = old.shortindex;
+            copy->numericindex = old.numericindex;
+            copy->numericbare = old.numericbare;
+            copy->numericdeclared = old.numericdeclared;
+            copy->longindex = old.longindex;
+            copy->dosindex = old.dosindex;
+            copy->abbrevtrie = old.abbrevtrie;
+            copy->familytrie = old.familytrie;
+            copy->dispatch = old.dispatch;
+            copy->allowabbrev = old.allowabbrev;
+            copy->singledashlong = old.singledashlong;
+            copy->stopif_funcs = old.stopif_funcs;
+            copy->stopif_ctxfuncs = old.stopif_ctxfuncs;
+            copy->helpbanner.str(old.helpbanner.str());
+            copy->helpbanner.seekp(0, std::ios_base::end);
+            copy->helptail.str(old.helptail.str());
+            copy->helptail.seekp(0, std::ios_base::end);
+            copy->dosoptsdeclared = old.dosoptsdeclared;
+            copy->on_unknownoptfn = old.on_unknownoptfn;
+            copy->declhelp = old.declhelp;
+            copy->commands.resize(old.commands.size());
+            for(i=0; i<old.commands.size(); i++)
+            {
+                copy->commands[i].name = old.commands[i].name;
+                copy->commands[i].description = old.commands[i].description;
+                copy->commands[i].factory = old.commands[i].factory;
+            }
+            copy->commandindex = old.commandindex;
+            copy->parent = old.parent;
+            // the "-h" callback prints the help of the schema it was declared in
+            if(copy->declhelp)
+            {
+                copy->callbacks[0] = Callback(helpCallback(*copy));
+            }
+            m_schema = copy;
+            m_commands.clear();
+        }
+
+        /*
+        * like ensureMutable(), but only for binding callbacks: a loaded schema is frozen,
+        * yet its callbacks still need to be bound. the schema is copied only if shared.
+        */
+        inline void ensureBindable()
+        {
+            if(m_frozen)
+            {
+                throwError<Error>("parser is frozen; its declarations can no longer be changed");
+            }
+            if(m_schema.use_count() > 1)
+            {
+                detachSchema();
+            }
+        }
+
+        Declaration& bindId(uint32_t id, const Callback& cb)
+        {
+            Declaration* decl;
+            if(id >= m_schema->declarations.size())
+            {
+                throwError<Error>("declaration id out of range");
+            }
+            ensureBindable();
+            decl = m_schema->declarations[id];
+            decl->selfref = this;
+            m_schema->callbacks[id] = cb;
+            return *decl;
+        }
+
+        // identifies schema files; followed by schemaversion.
+        static constexpr char schemamagic[8] = {'O', 'P', 'T', 'S', 'C', 'H', 'E', 'M'};
+
+        // bump whenever the layout of schema files, or any of the hash functions change.
+        static constexpr uint32_t schemaversion = 3;
+
+        // a Declaration, as stored in a schema file. strings refer to the string section.
+        struct DeclRecord
+        {
+            uint32_t firstname;
+            uint32_t lastname;
+            uint32_t descoffset;
+            uint32_t desclength;
+
+            // npos, if the default placeholder is used
+            uint32_t phoffset;
+            uint32_t phlength;
+            uint32_t hasplaceholder;
+        };
+
+        /*
+        * the layout of anything written as-is. files written with a different
+        * layout (i.e., on another platform) are refused by readSchema().
+        */
+        static constexpr uint32_t schemalayout[] =
+        {
+            0x01020304, sizeof(CharT), sizeof(size_t), sizeof(NameRef), sizeof(DeclRecord),
+            sizeof(typename NameIndex<false>::Slot), sizeof(typename PrefixTrie::Node),
+        };
+
+        static void writeSchema(SchemaWriter& w, const Schema& sch)
+        {
+            size_t i;
+            string strings;
+            string banner;
+            string tail;
+            std::vector<DeclRecord> decls;
+            decls.resize(sch.declarations.size());
+            for(i=0; i<sch.declarations.size(); i++)
+            {
+                const Declaration* decl = sch.declarations[i];
+                DeclRecord& rec = decls[i];
+                rec.firstname = decl->firstname;
+                rec.lastname = decl->lastname;
+                rec.descoffset = uint32_t(strings.size());
+                rec.desclength = uint32_t(decl->description.size());
+                strings.append(decl->description.data(), decl->description.size());
+                rec.phoffset = npos;
+                rec.phlength = 0;
+                if(decl->placeholder.data() != defaultplaceholder)
+                {
+                    rec.phoffset = uint32_t(strings.size());
+                    rec.phlength = uint32_t(decl->placeholder.size());
+                    strings.append(decl->placeholder.data(), decl->placeholder.size());
+                }
+                rec.hasplaceholder = decl->hasplaceholder;
+            }
+            w.array(schemamagic, sizeof(schemamagic));
+            w.value(schemaversion);
+            w.array(schemalayout, std::size(schemalayout));
+            w.value(uint8_t(sch.declhelp));
+            w.value(uint8_t(sch.allowabbrev));
+            w.value(uint8_t(sch.singledashlong));
+            w.value(uint8_t(sch.dosoptsdeclared));
+            w.value(uint8_t(sch.numericdeclared));
+            w.value(sch.numericbare);
+            w.array(strings.data(), strings.size());
+            w.array(decls.data(), decls.size());
+            w.array(sch.declflags.data(), sch.declflags.size());
+            w.array(sch.nametable.data(), sch.nametable.size());
+            w.array(sch.names.data(), sch.names.size());
+            sch.shortindex.write(w);
+            sch.numericindex.write(w);
+            sch.longindex.write(w);
+            sch.dosindex.write(w);
+            sch.abbrevtrie.write(w);
+            sch.familytrie.write(w);
+            sch.dispatch.write(w);
+            w.array(sch.helptext.data(), sch.helptext.size());
+            banner = sch.helpbanner.str();
+            w.array(banner.data(), banner.size());
+            tail = sch.helptail.str();
+            w.array(tail.data(), tail.size());
+        }
+
+        /*
+        * the counterpart of writeSchema(): tables are copied out of $file as they are
+        * (nothing is hashed, or parsed again), while descriptions and placeholders
+        * point straight into it. the result is frozen, and has no callbacks bound, save
+        * for "-h" (see bind()).
+        */
+        static std::shared_ptr<Schema> readSchema(const std::shared_ptr<const MappedFile>& file, const std::string& path)
+        {
+            size_t i;
+            size_t count;
+            size_t nstrings;
+            const char* magic;
+            const CharT* strings;
+            const CharT* text;
+            const uint32_t* layout;
+            const DeclRecord* decls;
+            Declaration* decl;
+            std::shared_ptr<Schema> sch;
+            SchemaReader r(file->data(), file->size());
+            magic = r.template array<char>(count);
+            if((count != sizeof(schemamagic)) || (std::memcmp(magic, schemamagic, count) != 0))
+            {
+                throwError<IOError>("'", path, "' is not a schema file");
+            }
+            if(r.template value<uint32_t>() != schemaversion)
+            {
+                throwError<IOError>("'", path, "' was written by an incompatible version");
+            }
+            layout = r.template array<uint32_t>(count);
+            if((count != std::size(schemalayout)) || (std::memcmp(layout, schemalayout, sizeof(schemalayout)) != 0))
+            {
+                throwError<IOError>("'", path, "' was written on an incompatible platform");
+            }
+            sch = std::make_shared<Schema>();
+            sch->backing = file;
+            sch->declhelp = r.template value<uint8_t>();
+            sch->allowabbrev = r.template value<uint8_t>();
+            sch->singledashlong = r.template value<uint8_t>();
+            sch->dosoptsdeclared = r.template value<uint8_t>();
+            sch->numericdeclared = r.template value<uint8_t>();
+            sch->numericbare = r.template value<uint32_t>();
+            strings = r.template array<CharT>(nstrings);
+            decls = r.template array<DeclRecord>(count);
+            r.array(sch->declflags);
+            r.expect(sch->declflags.size() == count);
+            text = r.template array<CharT>(i);
+            sch->nametable.assign(text, i);
+            r.array(sch->names);
+            sch->declarations.resize(count);
+            sch->callbacks.resize(count);
+            for(i=0; i<count; i++)
+            {
+                const DeclRecord& rec = decls[i];
+                r.expect((rec.firstname == npos) || (rec.firstname < sch->names.size()));
+                r.expect((rec.lastname == npos) || (rec.lastname < sch->names.size()));
+                r.expect((rec.descoffset <= nstrings) && (rec.desclength <= (nstrings - rec.descoffset)));
+                decl = sch->arena.template make<Declaration>();
+                decl->id = uint32_t(i);
+                decl->firstname = rec.firstname;
+                decl->lastname = rec.lastname;
+                decl->hasplaceholder = (rec.hasplaceholder != 0);
+                decl->description = std::basic_string_view<CharT>(strings + rec.descoffset, rec.desclength);
+                if(rec.phoffset != npos)
+                {
+                    r.expect((rec.phoffset <= nstrings) && (rec.phlength <= (nstrings - rec.phoffset)));
+                    decl->placeholder = std::basic_string_view<CharT>(strings + rec.phoffset, rec.phlength);
+                }
+                decl->selfref = nullptr;
+                decl->schema = sch.get();
+                sch->declarations[i] = decl;
+            }
+            for(i=0; i<sch->names.size(); i++)
+            {
+                const NameRef& ref = sch->names[i];
+                r.expect((ref.decl < count) && ((ref.next == npos) || (ref.next < sch->names.size())));
+                r.expect((ref.offset <= sch->nametable.size()) && (ref.length <= (sch->nametable.size() - ref.offset)));
+            }
+            r.expect((sch->numericbare == npos) || (sch->numericbare < count));
+            sch->shortindex.read(r, count);
+            sch->numericindex.read(r, count);
+            sch->longindex.read(r, count, sch->nametable.size());
+            sch->dosindex.read(r, count, sch->nametable.size());
+            sch->abbrevtrie.read(r, count);
+            sch->familytrie.read(r, count);
+            sch->dispatch.read(r);
+            text = r.template array<CharT>(i);
+            sch->helptext.assign(text, i);
+            text = r.template array<CharT>(i);
+            sch->helpbanner.str(string(text, i));
+            sch->helpbanner.seekp(0, std::ios_base::end);
+            text = r.template array<CharT>(i);
+            sch->helptail.str(string(text, i));
+            sch->helptail.seekp(0, std::ios_base::end);
+            if(sch->declhelp)
+            {
+                r.expect(count > 0);
+                sch->callbacks[0] = Callback(helpCallback(*sch));
+            }
+            sch->frozen = true;
+            return sch;
+        }
+
+        /*
+        * wraparound for invoke_on_unknown.
+        */
+        inline bool invoke_on_unknown_prox(const string& optstr) const
+        {
+            if(m_schema->on_unknownoptfn == nullptr)
+            {
+                return true;
+            }
+            return m_schema->on_unknownoptfn(optstr);
+        }
+
+        /*
+        * called, when an unknown long option (i.e., '--foo') is encountered.
+        */
+        inline bool invoke_on_unknown(const string& str) const
+        {
+            string ostr;
+            ostr.append("--");
+            ostr.append(str);
+            return invoke_on_unknown_prox(ostr);
+        }
+
+        /*
+        * called, when an unknown short option (i.e., '-c') is encountered.
+        */
+        inline bool invoke_on_unknown(std::basic_string_view<CharT> opt) const
+        {
+            string optstr;
+            optstr.push_back('-');
+            optstr.append(opt.data(), opt.size());
+            return invoke_on_unknown_prox(optstr);
+        }
+
+        /*
+        * wraps exception to either be thrown, or forwarded to invoke_on_unknown.
+        * useful for when exception are unavailable (i think? never encountered such a scenario).
+        */
+        template<typename ExceptionT, typename ValType, typename... Args>
+        inline void invoke_or_throw(const ParseContext& ctx, const ValType& val, size_t& iref, size_t howmuch, Args&&... args) const
+        {
+            size_t tmp;
+            if(invoke_on_unknown(val))
+            {
+                throwError<ExceptionT>(args...);
+            }
+            tmp = (iref + howmuch);
+            if((tmp + 1) != ctx.m_vargs.size())
+            {
+                iref = tmp;
+            }
+        }
+
+        bool hasplaceholder(const std::string& optpat, std::string& dest, size_t& subend, bool islong)
+        {
+            size_t ibegin;
+            char end;
+            end = *(optpat.end() - 1);
+            if(end == '>')
+            {
+                ibegin = optpat.find_first_of('<');
+                if(ibegin < optpat.size())
+                {
+                    // "--foo=<" vs "/foo:<"
+                    subend = ibegin - (islong ? 3 : 2);
+                    // substr behaves weirdly. why can't C++ just be normal?
+                    dest = std::string(optpat.begin() + (ibegin+1), optpat.end() - 1);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /*
+        * the result of parsePatterns().
+        */
+        struct ParsedPatterns
+        {
+            // the names, and their kind (see NameRef::Kind)
+            std::vector<std::pair<string, uint8_t>> names;
+
+            // whether the patterns declared a value
+            bool needvalue = false;
+
+            // whether, and which placeholder was declared
+            bool hasplaceholder = false;
+            string placeholder;
+        };
+
+        /*
+        * properly deparse declarations into Declaration types.
+        * expected grammar must fit in either of these:
+        *
+        * short option (getopt style):
+        *   # -v
+        *   # -o?
+        *   "-" <char> ( "?" | ( "<" <string> ">" )
+        *
+        * long option (GNU style):
+        *   # --verbose
+        *   # --outputfile=?
+        *   "--" <string> ( "=?" | ( "=<" <string> ">" ) )
+        *
+        * long option (DOS style):
+        *   # /?
+        *   # /v
+        *   # /verbose
+        *   # /out:?
+        *   "/" <string> ( ":?" | ( ":<" <string> ">" )
+        *
+        * prefix family (compiler driver style):
+        *   # -W*
+        *   # -f*
+        *   # --enable-*
+        *   ( "-" | "--" ) <string> "*"
+        *   any argument starting with the prefix (and not being *just* the prefix)
+        *   invokes the callback, with the rest of the argument as value. that is,
+        *   "-Wno-unused" invokes the callback of "-W*" with "no-unused".
+        *   the prefix must not be a lone "-", which would take every short option;
+        *   "--*" on the other hand takes any long option that is not declared.
+        *
+        * 'alnum' is alphanumeric, i.e., alphabet (uppercase & lowercase) + digits.
+        */
+        void parsePatterns(const std::vector<string>& strs, ParsedPatterns& dest)
+        {
+            size_t i;
+            size_t subend;
+            size_t shortlen;
+            bool hph;
+            bool isgnu;
+            bool hadlongopts;
+            bool hadshortopts;
+            bool longwantvalue;
+            bool shortwantvalue;
+            string longstr;
+            string shortstr;
+            string longname;
+            string placeholder;
+            uint32_t shortname;
+            CharT shortbegin;
+            CharT shortend;
+            CharT longbegin1;
+            CharT longbegin2;
+            CharT longend;
+            CharT longeq;
+            hadlongopts = false;
+            hadshortopts = false;
+            longwantvalue = false;
+            shortwantvalue = false;
+			(void)shortbegin;
+            for(i=0; i<strs.size(); i++)
+            {
+                hph = false;
+                /*
+                * grammar (pseudo): ("-" | "--") <string> "*"
+                * the name of a family is the prefix, including the dash(es).
+                */
+                if((strs[i].size() > 2) && (strs[i][0] == '-') && (*(strs[i].end() - 1) == '*'))
+                {
+                    dest.names.emplace_back(strs[i].substr(0, strs[i].size() - 1), NameRef::FAMILY);
+                    continue;
+                }
+                /*
+                * grammar (pseudo): ("--" | "/") <string:alphabet> (("=" | ":") "?")
+                *
+                * if DOS syntax is used (i.e., "/out"), which would need a value, it
+                * needs to be declared as "/out:?", but NOT as "/out=?".
+                * likewise, if GNU syntax is used, the decl needs to be "--out=?", but
+                * NOT "--out:?".
+                * the DOS variant must be immediately followed by an alpanumeric char.
+                */
+                if(isvalidlongopt(strs[i]) || isvaliddosopt(strs[i]))
+                {
+                    /*
+                    * longbegin1 is the first char in longstr
+                    * longbegin2 is the second char in longstr
+                    * longend is the last char in longstr
+                    * longeq is the char before the last char in longstr
+                    * if the syntax is correct, the grammar is as such (pseudo):
+                    *   "--" <string> ("=?")
+                    */
+                    hadlongopts = true;
+                    longstr = strs[i];
+                    longbegin1 = longstr[0];
+                    longbegin2 = longstr[1];
+                    longend = (*(longstr.end() - 1));
+                    longeq = (*(longstr.end() - 2));
+                    isgnu = ((longbegin1 == '-') && (longbegin2 == '-'));
+                    if(isgnu)
+                    {
+                        /* "--foo=?" = $length - len("=?") */
+                        subend = longstr.size() - 4;
+                        /* allow on({"--foo=<name>"})*/
+                        hph = hasplaceholder(longstr, placeholder, subend, true);
+                        longwantvalue = (((longeq == '=') && (longend == '?')) || hph);
+                        if(longwantvalue)
+                        {
+                            longname = longstr.substr(2).substr(0, subend);
+                            if(hph)
+                            {
+                                dest.hasplaceholder = true;
+                                dest.placeholder = placeholder;
+                            }
+                        }
+                        else
+                        {
+                            longname = longstr.substr(2);
+                        }
+                    }
+                    // ms-style options can be '/foo:bar', but also '-foo:bar'
+                    else if((longbegin1 == '/') || (longbegin1 == '-'))
+                    {
+                        // "/foo:?" = $length - len(":?")
+                        subend = longstr.size() - 3;
+                        hph = hasplaceholder(longstr, placeholder, subend, false);
+                        longwantvalue = (((longeq == ':') && (longend == '?')) || hph);
+                        if(longwantvalue)
+                        {
+                            longname = longstr.substr(1).substr(0, subend);
+                            if(hph)
+                            {
+                                dest.hasplaceholder = true;
+                                dest.placeholder = placeholder;
+                            }
+                        }
+                        else
+                        {
+                            longname = longstr.substr(1);
+                        }
+                    }
+                    else
+                    {
+                        throwError<Error>("impossible situation: failed to parse '", longstr, "'");
+                    }
+                    dest.names.emplace_back(longname, (isgnu ? NameRef::GNU : NameRef::DOS));
+                }
+                /*
+                * grammar (pseudo): "-" <char:alnum> ("?")
+                * also allows declaring numeric flags, i.e., "-0" (like grep, sort of).
+                * for whole ranges of numbers, use onNumber() instead.
+                */
+                else if((strs[i][0] == '-') && isalphanum(strs[i][1]))
+                {
+                    /*
+                    * shortbegin is the first char in shortstr
+                    * shortname is the code point after it, which is $shortlen chars long
+                    * shortend is the last char in shortstr
+                    */
+                    hadshortopts = true;
+                    shortstr = strs[i];
+                    shortbegin = shortstr[0];
+                    shortname = decodechar(shortstr.data() + 1, shortstr.size() - 1, shortlen);
+                    shortend = *(shortstr.end() - 1);
+                    if(shortname == badchar)
+                    {
+                        throwError<Error>("invalid character in short option '", shortstr, "'");
+                    }
+                    // permits declaring '-?'
+                    shortwantvalue = ((shortend == '?') && (shortstr.size() > (shortlen + 1)));
+                    hph = hasplaceholder(shortstr, placeholder, subend, false);
+                    dest.names.emplace_back(shortstr.substr(1, shortlen), NameRef::SHORT);
+                    if(hph)
+                    {
+                        shortwantvalue = true;
+                        dest.hasplaceholder = true;
+                        dest.placeholder = placeholder;
+                    }
+                }
+                else
+                {
+                    throwError<Error>("unparseable option syntax '", strs[i],"'");
+                }
+            }
+            /*
+            * ensure parsing state sanity: if one option requires a value, then
+            * every other option must too.
+            * TODO: optional mandatory value (silly sentence), like some
+            * clang options?
+            */
+            if(longwantvalue == true)
+            {
+                if((shortwantvalue == false) && (hadshortopts == true))
+                {
+                    throwError<Error>("long option ended in '=?', but short option did not");
+                }
+            }
+            if(shortwantvalue == true)
+            {
+                if((longwantvalue == false) && (hadlongopts == true))
+                {
+                    throwError<Error>("short option ended in '?', but long option did not");
+                }
+            }
+            dest.needvalue = (longwantvalue || shortwantvalue);
+        }
+
+        inline Declaration& addDeclaration(const std::vector<string>& strs, const string& desc, Callback fn, uint8_t extraflags=0)
+        {
+            size_t i;
+            Declaration* decl;
+            ParsedPatterns parsed;
+            ensureMutable();
+            if(strs.size() == 0)
+            {
+                // return, but don't actually do anything ....
+                // this isn't technically an error, but it will be completely ignored
+                decl = newDeclaration(desc.data(), desc.size());
+                commitDeclaration(decl, 0, fn);
+                return *decl;
+            }
+            parsePatterns(strs, parsed);
+            if((extraflags & DECL_NEGATABLE) && parsed.needvalue)
+            {
+                throwError<Error>("negatable options cannot take a value");
+            }
+            decl = newDeclaration(desc.data(), desc.size());
+            if(parsed.hasplaceholder)
+            {
+                decl->hasplaceholder = true;
+                decl->placeholder = m_schema->arena.intern(parsed.placeholder.data(), parsed.placeholder.size());
+            }
+            commitDeclaration(decl, ((parsed.needvalue ? DECL_NEEDVALUE : 0) | extraflags), fn);
+            for(i=0; i<parsed.names.size(); i++)
+            {
+                addName(decl, parsed.names[i].first.data(), parsed.names[i].first.size(), parsed.names[i].second, true);
+            }
+            return *decl;
+        }
+
+        /*
+        * implements Declaration::alias(): adds the names in $opts to $decl.
+        * every name must be unused (or already belong to $decl).
+        */
+        void addAliases(Declaration& decl, const std::vector<string>& opts)
         {
-            string msg;
+            size_t i;
+            size_t used;
+            uint32_t id;
+            uint32_t other;
+            ParsedPatterns parsed;
+            /*
+            * $decl may belong to a schema this parser no longer uses, or is about to
+            * replace with a copy - so only its id is used.
+            */
+            id = decl.id;
+            ensureMutable();
+            Declaration& own = *(m_schema->declarations[id]);
+            parsePatterns(opts, parsed);
+            if(parsed.needvalue != own.needvalue())
+            {
+                throwError<Error>("aliases must agree with their declaration on whether a value is needed");
+            }
+            for(i=0; i<parsed.names.size(); i++)
+            {
+                const string& name = parsed.names[i].first;
+                other = npos;
+                if(parsed.names[i].second == NameRef::SHORT)
+                {
+                    other = find_decl_short(decodechar(name.data(), name.size(), used));
+                }
+                else if(parsed.names[i].second == NameRef::GNU)
+                {
+                    other = find_decl_long(name.data(), name.size());
+                }
+                else if(parsed.names[i].second == NameRef::DOS)
+                {
+                    other = find_decl_dos(name.data(), name.size());
+                }
+                if((other != npos) && (other != own.id))
+                {
+                    throwError<Error>("cannot alias '", name, "': already declared by another option");
+                }
+            }
+            for(i=0; i<parsed.names.size(); i++)
+            {
+                addName(&own, parsed.names[i].first.data(), parsed.names[i].first.size(), parsed.names[i].second, true);
+            }
+        }
+
+        /*
+        * allocates a new declaration (and its description) from the arena.
+        */
+        inline Declaration* newDeclaration(const CharT* desc, size_t desclen)
+        {
+            Declaration* decl;
+            decl = m_schema->arena.template make<Declaration>();
+            decl->description = m_schema->arena.intern(desc, desclen);
+            return decl;
+        }
+
+        /*
+        * assigns $decl its id, and appends its hot data.
+        */
+        inline void commitDeclaration(Declaration* decl, uint8_t flags, const Callback& fn)
+        {
+            decl->selfref = this;
+            decl->schema = m_schema.get();
+            decl->id = uint32_t(m_schema->declarations.size());
+            m_schema->declarations.push_back(decl);
+            m_schema->declflags.push_back(flags);
+            m_schema->callbacks.push_back(fn);
+        }
+
+        /*
+        * interns $name as a name of $decl. if $index is true, it is added to
+        * the short or long lookup index as well.
+        */
+        void addName(Declaration* decl, const CharT* name, size_t len, uint8_t kind, bool index)
+        {
+            size_t i;
+            size_t used;
+            uint32_t idx;
+            NameRef ref;
+            ref.offset = uint32_t(m_schema->nametable.size());
+            ref.length = uint32_t(len);
+            ref.decl = decl->id;
+            ref.next = npos;
+            ref.kind = kind;
+            m_schema->nametable.append(name, len);
+            idx = uint32_t(m_schema->names.size());
+            m_schema->names.push_back(ref);
+            if(decl->lastname == npos)
+            {
+                decl->firstname = idx;
+            }
+            else
+            {
+                m_schema->names[decl->lastname].next = idx;
+            }
+            decl->lastname = idx;
+            if(kind == NameRef::SHORT)
+            {
+                if(index)
+                {
+                    m_schema->shortindex.put(decodechar(name, len, used), decl->id);
+                }
+            }
+            else if(kind == NameRef::FAMILY)
+            {
+                m_schema->familytrie.insert(name, len, decl->id);
+                // "--*" matches any long option. ("-*" is no family, see parsePatterns())
+                if(name[1] != '-')
+                {
+                    m_schema->dispatch.mark(name[1], DispatchTable::DISPATCH_FAMILY);
+                }
+                else if(len == 2)
+                {
+                    m_schema->dispatch.markAll(DispatchTable::DISPATCH_LONGFAMILY);
+                }
+                else
+                {
+                    m_schema->dispatch.mark(name[2], DispatchTable::DISPATCH_LONGFAMILY);
+                }
+            }
+            else if(kind == NameRef::NUMERIC)
+            {
+                if(len == 1)
+                {
+                    if(m_schema->numericbare == npos)
+                    {
+                        m_schema->numericbare = decl->id;
+                    }
+                    for(i=0; i<10; i++)
+                    {
+                        m_schema->dispatch.mark(CharT('0' + i), DispatchTable::DISPATCH_NUMERIC);
+                    }
+                }
+                else
+                {
+                    m_schema->numericindex.put(typename std::make_unsigned<CharT>::type(name[1]), decl->id);
+                    m_schema->dispatch.mark(name[1], DispatchTable::DISPATCH_NUMERIC);
+                }
+                m_schema->numericdeclared = true;
+            }
+            else if(kind == NameRef::DOS)
+            {
+                if(index)
+                {
+                    m_schema->dosindex.insert(m_schema->nametable.data(), ref.offset, ref.length, decl->id);
+                }
+                m_schema->dosoptsdeclared = true;
+            }
+            else
+            {
+                if(index)
+                {
+                    m_schema->longindex.insert(m_schema->nametable.data(), ref.offset, ref.length, decl->id);
+                }
+                // once built, the trie is kept complete, even while abbreviations are disabled
+                if(m_schema->allowabbrev || !m_schema->abbrevtrie.empty())
+                {
+                    m_schema->abbrevtrie.insert(name, len, decl->id);
+                }
+                if(len > 0)
+                {
+                    m_schema->dispatch.mark(name[0], DispatchTable::DISPATCH_LONG);
+                }
+                if(m_schema->declflags[decl->id] & DECL_NEGATABLE)
+                {
+                    m_schema->dispatch.mark('n', DispatchTable::DISPATCH_LONG);
+                }
+            }
+        }
+
+        /*
+        * if $name is "no-<name>", and <name> is a long option of a negatable
+        * declaration, returns its id. otherwise, returns npos.
+        * negated names are never stored anywhere - they resolve through the entry
+        * of the positive name.
+        */
+        inline uint32_t find_decl_negated(const CharT* name, size_t len) const
+        {
+            uint32_t decl;
+            if((len < 4) || (name[0] != 'n') || (name[1] != 'o') || (name[2] != '-'))
+            {
+                return npos;
+            }
+            decl = find_decl_long(name + 3, len - 3);
+            if((decl == npos) || !(m_schema->declflags[decl] & DECL_NEGATABLE))
+            {
+                return npos;
+            }
+            return decl;
+        }
+
+        /*
+        * resolves an abbreviated long option through Schema::abbrevtrie.
+        * returns npos if no long option starts with $name, and throws
+        * AmbiguousOptionError if more than one declaration does.
+        */
+        uint32_t find_decl_abbrev(const CharT* name, size_t len) const
+        {
+            size_t i;
+            string prefix;
             stringstream buf;
-            ((buf << args), ...);
-            msg = buf.str();
-            throw ExClass(msg);
+            std::vector<string> candidates;
+            const typename PrefixTrie::Node* node;
+            node = m_schema->abbrevtrie.walk(name, len);
+            if(node == nullptr)
+            {
+                return npos;
+            }
+            if(node->ambiguous)
+            {
+                prefix.assign(name, len);
+                m_schema->abbrevtrie.collect(node, prefix, candidates);
+                for(i=0; i<candidates.size(); i++)
+                {
+                    buf << " '--" << candidates[i] << "'";
+                }
+                throwError<AmbiguousOptionError>("option '--", string(name, len), "' is ambiguous; possibilities:", buf.str());
+            }
+            return node->decl;
+        }
+
+        /*
+        * creates the declarations of a StaticSchema, which must be the first ones of the
+        * schema of this parser: option $i of the schema becomes staticdecl($i).
+        * patterns are never parsed here, since compileSchema() already did that.
+        * the declarations are *not* added to the lookup indexes - they are resolved
+        * through $lookup instead, which must use the same schema.
+        */
+        template<typename SchemaT>
+        void addStaticDeclarations(const SchemaT& schema, const StaticLookup* lookup)
+        {
+            size_t i;
+            Declaration* decl;
+            for(i=0; i<SchemaT::declcount; i++)
+            {
+                if(staticdecl(i) == npos)
+                {
+                    continue;
+                }
+                // the schema outlives the parser, so its strings need not be copied
+                decl = m_schema->arena.template make<Declaration>();
+                decl->hasplaceholder = schema.decls[i].hasplaceholder;
+                if(decl->hasplaceholder)
+                {
+                    decl->placeholder = schema.decls[i].placeholder;
+                }
+                decl->description = schema.decls[i].description;
+                commitDeclaration(decl, (schema.decls[i].needvalue ? DECL_NEEDVALUE : 0), ((i == 0) ? Callback(helpCallback(*m_schema)) : Callback()));
+            }
+            for(const auto& nm: schema.shortnames)
+            {
+                if(staticdecl(nm.decl) != npos)
+                {
+                    addName(m_schema->declarations[staticdecl(nm.decl)], nm.name.data(), nm.name.size(), NameRef::SHORT, false);
+                }
+            }
+            for(const auto& nm: schema.longnames)
+            {
+                if(staticdecl(nm.decl) != npos)
+                {
+                    addName(m_schema->declarations[staticdecl(nm.decl)], nm.name.data(), nm.name.size(), (nm.isgnu ? NameRef::GNU : NameRef::DOS), false);
+                }
+            }
+            m_staticlookup = lookup;
         }
 
         /*
-        * wraparound for invoke_on_unknown.
+        * the id of the declaration of option $idx of the StaticSchema of this parser.
+        * option 0 is "-h"/"--help" (see compileSchema()), which only exists if help was
+        * declared, so that the ids of the others depend on it. returns npos if there is
+        * no such declaration - or if $idx is npos itself, as returned by StaticLookup.
         */
-        inline bool invoke_on_unknown_prox(const string& optstr)
+        inline uint32_t staticdecl(size_t idx) const
         {
-            if(m_on_unknownoptfn == nullptr)
+            if((idx == size_t(-1)) || ((idx == 0) && !m_schema->declhelp))
             {
-                return true;
+                return npos;
             }
-            return m_on_unknownoptfn(optstr);
+            return uint32_t(m_schema->declhelp ? idx : (idx - 1));
         }
 
         /*
-        * called, when an unknown long option (i.e., '--foo') is encountered.
+        * lookup functions return the id of the declaration, or npos if no such
+        * option was declared.
+        * the options of a StaticSchema (see addStaticDeclarations()) come first.
         */
-        inline bool invoke_on_unknown(const string& str)
+        inline uint32_t find_decl_long(const CharT* name, size_t len) const
         {
-            string ostr;
-            ostr.append("--");
-            ostr.append(str);
-            return invoke_on_unknown_prox(ostr);
+            uint32_t decl;
+            decl = ((m_staticlookup != nullptr) ? staticdecl(m_staticlookup->find_long(name, len)) : npos);
+            if(decl != npos)
+            {
+                return decl;
+            }
+            return m_schema->longindex.find(m_schema->nametable.data(), name, len);
         }
 
-        /*
-        * called, when an unknown short option (i.e., '-c') is encountered.
-        */
-        inline bool invoke_on_unknown(CharT opt)
+        // $cp is a code point, as returned by decodechar().
+        inline uint32_t find_decl_short(uint32_t cp) const
         {
-            string optstr;
-            optstr.push_back('-');
-            optstr.push_back(CharT(opt));
-            return invoke_on_unknown_prox(optstr);
+            uint32_t decl;
+            // static schemas only permit ASCII short options
+            decl = (((m_staticlookup != nullptr) && (cp < 0x80)) ? staticdecl(m_staticlookup->find_short(CharT(cp))) : npos);
+            if(decl != npos)
+            {
+                return decl;
+            }
+            return m_schema->shortindex.get(cp);
+        }
+
+        // $name is matched case-insensitively.
+        inline uint32_t find_decl_dos(const CharT* name, size_t len) const
+        {
+            uint32_t decl;
+            decl = ((m_staticlookup != nullptr) ? staticdecl(m_staticlookup->find_dos(name, len)) : npos);
+            if(decl != npos)
+            {
+                return decl;
+            }
+            return m_schema->dosindex.find(m_schema->nametable.data(), name, len);
         }
 
         /*
-        * wraps exception to either be thrown, or forwarded to invoke_on_unknown.
-        * useful for when exception are unavailable (i think? never encountered such a scenario).
+        * returns the parser $lvl levels up from this one, as seen by the run $ctx:
+        * 0 is this parser, 1 the parser of the enclosing command, and so on.
+        * returns nullptr past the outermost parser.
         */
-        template<typename ExceptionT, typename ValType, typename... Args>
-        inline void invoke_or_throw(const ValType& val, size_t& iref, size_t howmuch, Args&&... args)
+        inline const BasicOptionParser* enclosing(const ParseContext& ctx, size_t lvl) const
         {
-            size_t tmp;
-            if(invoke_on_unknown(val))
+            if(lvl == 0)
             {
-                throwError<ExceptionT>(args...);
+                return this;
             }
-            tmp = (iref + howmuch);
-            if((tmp + 1) != m_vargs.size())
+            if(lvl > ctx.m_outer.size())
             {
-                iref = tmp;
+                return nullptr;
             }
+            return ctx.m_outer[ctx.m_outer.size() - lvl];
         }
 
-        bool hasplaceholder(const std::string& optpat, std::string& dest, size_t& subend, bool islong)
+        /*
+        * like the find_decl_* functions, but if this is the parser of a subcommand,
+        * the parsers of the enclosing commands are searched as well (innermost first),
+        * so that global options keep working after the subcommand.
+        * the parser that declared the option is stored in $owner; the declaration
+        * id is only meaningful for its flags and callbacks.
+        */
+        uint32_t resolve_short(const ParseContext& ctx, uint32_t cp, const BasicOptionParser*& owner) const
         {
-            size_t ibegin;
-            char end;
-            (void)islong;
-            end = *(optpat.end() - 1);
-            if(end == '>')
+            size_t lvl;
+            uint32_t decl;
+            for(lvl=0; (owner=enclosing(ctx, lvl))!=nullptr; lvl++)
             {
-                ibegin = optpat.find_first_of('<');
-                if(ibegin < optpat.size())
+                decl = owner->find_decl_short(cp);
+                if(decl != npos)
                 {
-                    subend = ibegin - 3;
-                    // substr behaves weirdly. why can't C++ just be normal?
-                    dest = std::string(optpat.begin() + (ibegin+1), optpat.end() - 1);
-                    return true;
+                    return decl;
                 }
             }
-            return false;
+            owner = this;
+            return npos;
         }
 
-        /*
-        * properly deparse declarations into Declaration types.
-        * expected grammar must fit in either of these:
-        *
-        * short option (getopt style):
-        *   # -v
-        *   # -o?
-        *   "-" <char> ( "?" | ( "<" <string> ">" )
-        *
-        * long option (GNU style):
-        *   # --verbose
-        *   # --outputfile=?
-        *   "--" <string> ( "=?" | ( "=<" <string> ">" ) )
-        *
-        * long option (DOS style):
-        *   # /?
-        *   # /v
-        *   # /verbose
-        *   # /out:?
-        *   "/" <string> ( ":?" | ( ":<" <string> ">" )
-        *
-        * 'alnum' is alphanumeric, i.e., alphabet (uppercase & lowercase) + digits.
-        */
-        inline Declaration& addDeclaration(const std::vector<string>& strs, const string& desc, Callback fn)
+        // $negated is set if $name was found as "no-<name>".
+        uint32_t resolve_long(const ParseContext& ctx, const CharT* name, size_t len, const BasicOptionParser*& owner, bool& negated) const
         {
-            size_t i;
-            size_t subend;
-            bool hph;
-            bool isgnu;
-            bool hadlongopts;
-            bool hadshortopts;
-            bool longwantvalue;
-            bool shortwantvalue;
-            Declaration* decl;
-            string longstr;
-            string shortstr;
-            string longname;
-            string placeholder;
-            CharT shortname;
-            CharT shortbegin;
-            CharT shortend;
-            CharT longbegin1;
-            CharT longbegin2;
-            CharT longend;
-            CharT longeq;
-            decl = new Declaration;
-            hadlongopts = false;
-            hadshortopts = false;
-            longwantvalue = false;
-            shortwantvalue = false;
-            decl->selfref = this;
-            decl->description = desc;
-            decl->callback = fn;
-			(void)shortbegin;
-            if(strs.size() == 0)
-            {
-                // return, but don't actually do anything ....
-                // this isn't technically an error, but it will be completely ignored
-                return *decl;
-            }
-            for(i=0; i<strs.size(); i++)
+            size_t lvl;
+            uint32_t decl;
+            negated = false;
+            for(lvl=0; (owner=enclosing(ctx, lvl))!=nullptr; lvl++)
             {
-                /*
-                * grammar (pseudo): ("--" | "/") <string:alphabet> (("=" | ":") "?")
-                *
-                * if DOS syntax is used (i.e., "/out"), which would need a value, it
-                * needs to be declared as "/out:?", but NOT as "/out=?".
-                * likewise, if GNU syntax is used, the decl needs to be "--out=?", but
-                * NOT "--out:?".
-                * the DOS variant must be immediately followed by an alpanumeric char.
-                */
-                if(isvalidlongopt(strs[i]) || isvaliddosopt(strs[i]))
+                decl = owner->find_decl_long(name, len);
+                if(decl == npos)
                 {
-                    /*
-                    * longbegin1 is the first char in longstr
-                    * longbegin2 is the second char in longstr
-                    * longend is the last char in longstr
-                    * longeq is the char before the last char in longstr
-                    * if the syntax is correct, the grammar is as such (pseudo):
-                    *   "--" <string> ("=?")
-                    */
-                    hadlongopts = true;
-                    longstr = strs[i];
-                    longbegin1 = longstr[0];
-                    longbegin2 = longstr[1];
-                    longend = (*(longstr.end() - 1));
-                    longeq = (*(longstr.end() - 2));
-                    isgnu = ((longbegin1 == '-') && (longbegin2 == '-'));
-                    if(isgnu)
-                    {
-                        /* "--foo=?" = $length - len("=?") */
-                        subend = longstr.size() - 4;
-                        /* allow on({"--foo=<name>"})*/
-                        longwantvalue = (
-                            ((longeq == '=') && (longend == '?')) ||
-                            (hph = hasplaceholder(longstr, placeholder, subend, true))
-                        );
-                        if(longwantvalue)
-                        {
-                            longname = longstr.substr(2).substr(0, subend);
-                            if(hph)
-                            {
-                                decl->hasplaceholder = true;
-                                decl->placeholder = placeholder;
-                            }
-                        }
-                        else
-                        {
-                            longname = longstr.substr(2);
-                        }
-                    }
-                    // ms-style options can be '/foo:bar', but also '-foo:bar'
-                    else if((longbegin1 == '/') || (longbegin1 == '-'))
-                    {
-                        // "/foo:?" = $length - len(":?")
-                        subend = longstr.size() - 3;
-                        longwantvalue = (
-                            ((longeq == ':') && (longend == '?')) ||
-                            (hph=hasplaceholder(longstr, placeholder, subend, false))
-                        );
-                        if(longwantvalue)
-                        {
-                            longname = longstr.substr(1).substr(0, subend);
-                            if(hph)
-                            {
-                                decl->hasplaceholder = true;
-                                decl->placeholder = placeholder;
-                            }
-                        }
-                        else
-                        {
-                            longname = longstr.substr(1);
-                        }
-                        m_dosoptsdeclared = true;
-                    }
-                    else
-                    {
-                        delete decl;
-                        throwError<Error>("impossible situation: failed to parse '", longstr, "'");
-                    }
-                    decl->longnames.push_back(LongOption{longname, isgnu});
+                    decl = owner->find_decl_negated(name, len);
+                    negated = (decl != npos);
                 }
-                /*
-                * grammar (pseudo): "-" <char:alnum> ("?")
-                * also allows declaring numeric flags, i.e., "-0" (like grep, sort of)
-                * todo: allow numeric flags as a range - perhaps a wrapper function that
-                * auto-populates an array of options with the range of numbers?
-                */
-                else if((strs[i][0] == '-') && isalphanum(strs[i][1]))
+                if(decl != npos)
                 {
-                    /*
-                    * shortbegin is the first char in shortstr
-                    * shortname is the second char in shortstr
-                    * shortend is the last char in shortstr
-                    */
-                    hadshortopts = true;
-                    shortstr = strs[i];
-                    shortbegin = shortstr[0];
-                    shortname = shortstr[1];
-                    shortend = *(shortstr.end() - 1);
-                    // permits declaring '-?'
-                    shortwantvalue = ((shortend == '?') && (shortend != shortname));
-                    hph = hasplaceholder(shortstr, placeholder, subend, false);
-                    decl->shortnames.push_back(shortname);
-                    if(hph)
-                    {
-                        shortwantvalue = true;
-                        decl->hasplaceholder = true;
-                        decl->placeholder = placeholder;
-                    }
+                    return decl;
                 }
-                else
+            }
+            owner = this;
+            return npos;
+        }
+
+        // only parsers that allow abbreviations are searched.
+        uint32_t resolve_abbrev(const ParseContext& ctx, const CharT* name, size_t len, const BasicOptionParser*& owner) const
+        {
+            size_t lvl;
+            uint32_t decl;
+            for(lvl=0; (owner=enclosing(ctx, lvl))!=nullptr; lvl++)
+            {
+                if(owner->m_schema->allowabbrev)
                 {
-                    delete decl;
-                    throwError<Error>("unparseable option syntax '", strs[i],"'");
+                    decl = owner->find_decl_abbrev(name, len);
+                    if(decl != npos)
+                    {
+                        return decl;
+                    }
                 }
             }
-            /*
-            * ensure parsing state sanity: if one option requires a value, then
-            * every other option must too.
-            * TODO: optional mandatory value (silly sentence), like some
-            * clang options?
-            */
-            if(longwantvalue == true)
+            owner = this;
+            return npos;
+        }
+
+        uint32_t resolve_dos(const ParseContext& ctx, const CharT* name, size_t len, const BasicOptionParser*& owner) const
+        {
+            size_t lvl;
+            uint32_t decl;
+            for(lvl=0; (owner=enclosing(ctx, lvl))!=nullptr; lvl++)
             {
-                if((shortwantvalue == false) && (hadshortopts == true))
+                decl = owner->find_decl_dos(name, len);
+                if(decl != npos)
                 {
-                    delete decl;
-                    throwError<Error>("long option ended in '=?', but short option did not");
+                    return decl;
                 }
             }
-            if(shortwantvalue == true)
+            owner = this;
+            return npos;
+        }
+
+        /*
+        * returns the DispatchTable flags of $c, for this parser and the parsers of
+        * enclosing commands together.
+        */
+        inline uint8_t dispatchflags(const ParseContext& ctx, CharT c) const
+        {
+            size_t lvl;
+            uint8_t flags;
+            const BasicOptionParser* owner;
+            flags = 0;
+            for(lvl=0; (owner=enclosing(ctx, lvl))!=nullptr; lvl++)
             {
-                if((longwantvalue == false) && (hadlongopts == true))
+                flags |= owner->m_schema->dispatch.get(c);
+            }
+            return flags;
+        }
+
+        /*
+        * whether $setting is set in the schema of this parser, or of the parser of any
+        * enclosing command - subcommands inherit LLVM style long options, and need to
+        * recognize DOS style options of enclosing commands.
+        */
+        inline bool enclosingsetting(const ParseContext& ctx, bool Schema::*setting) const
+        {
+            size_t lvl;
+            const BasicOptionParser* owner;
+            for(lvl=0; (owner=enclosing(ctx, lvl))!=nullptr; lvl++)
+            {
+                if((*(owner->m_schema)).*setting)
                 {
-                    delete decl;
-                    throwError<Error>("short option ended in '?', but long option did not");
+                    return true;
                 }
             }
-            decl->needvalue = (longwantvalue && shortwantvalue);
-            m_declarations.push_back(decl);
-            return *decl;
+            return false;
         }
 
-        inline bool find_decl_long(const string& name, Declaration& decldest, size_t& idxdest)
+        /*
+        * if $arg starts with a declared prefix family (the longest one, if several
+        * match), invokes its callback with the rest of $arg, and returns true.
+        * families of enclosing commands are tried after the ones of this parser.
+        */
+        inline bool parse_family(const ParseContext& ctx, string_view arg) const
         {
-            size_t i;
-            for(i=0; i<m_declarations.size(); i++)
+            size_t matchlen;
+            uint32_t decl;
+            const BasicOptionParser* owner;
+            size_t lvl;
+            for(lvl=0; (owner=enclosing(ctx, lvl))!=nullptr; lvl++)
             {
-                if(m_declarations[i]->is(name))
+                if(owner->m_schema->familytrie.empty())
+                {
+                    continue;
+                }
+                matchlen = 0;
+                decl = owner->m_schema->familytrie.longest(arg.data(), arg.size(), matchlen);
+                if((decl != npos) && (matchlen < arg.size()))
                 {
-                    idxdest = i;
-                    decldest = *(m_declarations[i]);
+                    owner->m_schema->callbacks[decl].invoke(arg.substr(matchlen));
                     return true;
                 }
             }
             return false;
         }
 
-        inline bool find_decl_short(CharT name, Declaration& decldest, size_t& idxdest)
+        /*
+        * if $arg is a member of a numeric family (i.e., "-O3", "-j16", or "-9"), decodes
+        * the number straight from $arg, invokes the callback, and returns true.
+        * if anything other than digits follows the prefix, returns false, so that
+        * $arg is parsed as usual.
+        */
+        inline bool parse_numeric(const ParseContext& ctx, string_view arg) const
         {
             size_t i;
-            for(i=0; i<m_declarations.size(); i++)
+            size_t lvl;
+            size_t begin;
+            uint32_t decl;
+            unsigned long long num;
+            unsigned long long digit;
+            constexpr unsigned long long maxnum = std::numeric_limits<long long>::max();
+            CharT c;
+            const BasicOptionParser* owner;
+            c = charat(arg, 1);
+            decl = npos;
+            begin = (((c >= '0') && (c <= '9')) ? 1 : 2);
+            for(lvl=0; (owner=enclosing(ctx, lvl))!=nullptr; lvl++)
             {
-                if(m_declarations[i]->is(name))
+                if(owner->m_schema->numericdeclared)
                 {
-                    idxdest = i;
-                    decldest = *(m_declarations[i]);
-                    return true;
+                    decl = ((begin == 1) ? owner->m_schema->numericbare : owner->m_schema->numericindex.get(typename std::make_unsigned<CharT>::type(c)));
+                    if(decl != npos)
+                    {
+                        break;
+                    }
+                }
+            }
+            if((decl == npos) || (arg.size() <= begin))
+            {
+                return false;
+            }
+            num = 0;
+            for(i=begin; i<arg.size(); i++)
+            {
+                c = arg[i];
+                if((c < '0') || (c > '9'))
+                {
+                    return false;
+                }
+                digit = (unsigned long long)(c - '0');
+                if(num > ((maxnum - digit) / 10))
+                {
+                    throwError<ValueConversionError>("numeric option '", arg, "' is out of range");
                 }
+                num = ((num * 10) + digit);
+            }
+            owner->m_schema->callbacks[decl].invoke_number((long long)num);
+            return true;
+        }
+
+        /*
+        * if the arguments are fed one at a time (see feed()), and the one after $iref
+        * has not arrived yet, marks $ctx as waiting for it, and returns true.
+        * the argument at $iref is then parsed again, once the next one is there -
+        * hence, nothing may have been invoked for it yet.
+        */
+        static bool waitfornext(ParseContext& ctx, size_t iref)
+        {
+            if(ctx.m_feeding && ((iref + 1) == ctx.m_vargs.size()))
+            {
+                ctx.m_next = iref;
+                ctx.m_waiting = true;
+                return true;
             }
             return false;
         }
@@ -816,34 +3782,31 @@ class BasicOptionParser
         /*
         * parse a short option with more than one character, OR combined options.
         * sometimes refered to as GNU-style options.
+        * $str is the argument as-is, including the leading dash.
         */
-        inline void parse_multishort(const string& str, size_t& iref)
+        inline void parse_multishort(const ParseContext& ctx, string_view str, size_t& iref) const
         {
             size_t i;
-            size_t idx;
-            string ovalue;
-            Declaration decl;
-            idx = 0;
-            for(i=0; i<str.size(); i++)
+            size_t cplen;
+            uint32_t cp;
+            uint32_t decl;
+            const BasicOptionParser* owner;
+            for(i=1; i<str.size(); i+=cplen)
             {
-                /*
-                * $idx is the index of the option in question of the multishort string.
-                * i.e., if $str is "-ovd", and '-o' expects a value, then $idx-1 is the
-                * index of 'o' in $str
-                */
-                if(find_decl_short(str[i], decl, idx))
+                cp = decodechar(str.data() + i, str.size() - i, cplen);
+                decl = resolve_short(ctx, cp, owner);
+                if(decl != npos)
                 {
-                    if(decl.needvalue && (i == 0))
+                    if((owner->m_schema->declflags[decl] & DECL_NEEDVALUE) && (i == 1))
                     {
-                        if(str.size() > 1)
+                        if(str.size() > (1 + cplen))
                         {
-                            ovalue = str.substr(1);
-                            decl.callback.invoke(ovalue);
+                            owner->m_schema->callbacks[decl].invoke(str.substr(1 + cplen));
                             return;
                         }
                         else
                         {
-                            throwError<ValueNeededError>("option '-", str[idx-1], "' expected a value");
+                            throwError<ValueNeededError>("option '-", str.substr(i, cplen), "' expected a value");
                         }
                     }
                     else
@@ -853,21 +3816,21 @@ class BasicOptionParser
                         * also expected a value. afaik, this would result in an error
                         * in GNU getopt as well
                         */
-                        if(decl.needvalue)
+                        if((owner->m_schema->declflags[decl] & DECL_NEEDVALUE))
                         {
-                            throwError<ValueNeededError>("unexpected option '-", str[idx-1], "' requiring a value");
+                            throwError<ValueNeededError>("unexpected option '-", str.substr(i, cplen), "' requiring a value");
                         }
                         else
                         {
-                            decl.callback.invoke();
+                            owner->m_schema->callbacks[decl].invoke();
                         }
                     }
                 }
                 else
                 {
                     // invoke_on_unknown: multishort
-                    invoke_or_throw<InvalidOptionError>(str[i], iref, 0,
-                        "unknown short option '-", str[i], "'");
+                    invoke_or_throw<InvalidOptionError>(ctx, str.substr(i, cplen), iref, 0,
+                        "unknown short option '-", str.substr(i, cplen), "'");
                     /*
                     * if we don't return here, then it will just return back to this block,
                     * unless, by chance, the string(s) happen to contain an option
@@ -880,20 +3843,28 @@ class BasicOptionParser
             }
         }
 
-        inline void parse_simpleshort(CharT str, size_t& iref)
+        /*
+        * parse a single short option, like "-o".
+        * $str is the argument as-is, and $cp its (only) code point.
+        */
+        inline void parse_simpleshort(ParseContext& ctx, string_view str, uint32_t cp, size_t& iref) const
         {
-            size_t idx;
-            Declaration decl;
-            string value;
-            if(find_decl_short(str, decl, idx))
+            uint32_t decl;
+            const BasicOptionParser* owner;
+            decl = resolve_short(ctx, cp, owner);
+            if(decl != npos)
             {
-                if(decl.needvalue)
+                if((owner->m_schema->declflags[decl] & DECL_NEEDVALUE))
                 {
+                    if(waitfornext(ctx, iref))
+                    {
+                        return;
+                    }
                     /*
                     * decl wants a value, so grab value from the next argument, if
                     * the next arg isn't an option, and increase index
                     */
-                    if((iref+1) < m_vargs.size())
+                    if((iref+1) < ctx.m_vargs.size())
                     {
                         /*
                         * make sure the next argument isn't some sort of option;
@@ -902,163 +3873,559 @@ class BasicOptionParser
                         * otherwise, something like "-o -foo" would yield "-foo"
                         * as value!
                         */
-                        if(m_vargs[iref+1][0] != '-')
+                        if(charat(ctx.m_vargs[iref+1], 0) != '-')
                         {
-                            value = m_vargs[iref + 1];
                             iref++;
-                            decl.callback.invoke(value);
+                            owner->m_schema->callbacks[decl].invoke(ctx.m_vargs[iref]);
                             return;
                         }
                     }
-                    throwError<ValueNeededError>("option '-", str, "' expected a value");
+                    throwError<ValueNeededError>("option '", str, "' expected a value");
                 }
                 else
                 {
-                    decl.callback.invoke();
+                    owner->m_schema->callbacks[decl].invoke();
                 }
             }
             else
             {
                 // invoke_on_unknown: simpleshort
-                invoke_or_throw<InvalidOptionError>(str, iref, 0, "unknown option '-", str, "'");
+                invoke_or_throw<InvalidOptionError>(ctx, str.substr(1), iref, 0, "unknown option '", str, "'");
+            }
+        }
+
+        /*
+        * LLVM style: if the word after the single dash of $arg (up to a '=', if any)
+        * is a declared long option, invoke it, and return true.
+        * unlike GNU long options, a value may also be passed as next argument, i.e.,
+        * both "-out=foo" and "-out foo" work.
+        */
+        bool parse_singledashlong(ParseContext& ctx, string_view arg, size_t& iref) const
+        {
+            size_t eqpos;
+            size_t namelen;
+            bool negated;
+            uint32_t decl;
+            const BasicOptionParser* owner;
+            eqpos = arg.find_first_of('=');
+            namelen = ((eqpos == string::npos) ? arg.size() : eqpos) - 1;
+            decl = resolve_long(ctx, arg.data() + 1, namelen, owner, negated);
+            if(decl == npos)
+            {
+                return false;
+            }
+            if((eqpos != string::npos) && (owner->m_schema->declflags[decl] & DECL_NEGATABLE))
+            {
+                throwError<InvalidOptionError>("option '-", arg.substr(1, namelen), "' does not take a value");
+            }
+            if(negated)
+            {
+                owner->m_schema->callbacks[decl].invoke_toggle(false);
+                return true;
+            }
+            if(owner->m_schema->declflags[decl] & DECL_NEEDVALUE)
+            {
+                if(eqpos != string::npos)
+                {
+                    owner->m_schema->callbacks[decl].invoke(arg.substr(eqpos + 1));
+                }
+                else if(waitfornext(ctx, iref))
+                {
+                    return true;
+                }
+                else if(((iref + 1) < ctx.m_vargs.size()) && (charat(ctx.m_vargs[iref + 1], 0) != '-'))
+                {
+                    iref++;
+                    owner->m_schema->callbacks[decl].invoke(ctx.m_vargs[iref]);
+                }
+                else
+                {
+                    throwError<ValueNeededError>("option '-", arg.substr(1, namelen), "' expected a value");
+                }
+            }
+            else
+            {
+                owner->m_schema->callbacks[decl].invoke();
+            }
+            return true;
+        }
+
+        /*
+        * if $arg is "/name" or "/name:value", and "name" is a declared DOS option
+        * (ignoring case), invoke it, and return true.
+        * anything else, including unknown names, returns false, and is left to the
+        * caller to treat as positional argument - "/usr/bin" is far more likely a
+        * path than a typo.
+        * like "/out:foo", values must always be attached with ':'.
+        */
+        bool parse_dosoption(const ParseContext& ctx, string_view arg) const
+        {
+            size_t colpos;
+            size_t namelen;
+            uint32_t decl;
+            const BasicOptionParser* owner;
+            colpos = arg.find_first_of(':');
+            namelen = ((colpos == string::npos) ? arg.size() : colpos) - 1;
+            if(namelen == 0)
+            {
+                return false;
+            }
+            decl = resolve_dos(ctx, arg.data() + 1, namelen, owner);
+            if(decl == npos)
+            {
+                return false;
+            }
+            if(owner->m_schema->declflags[decl] & DECL_NEEDVALUE)
+            {
+                if(colpos == string::npos)
+                {
+                    throwError<ValueNeededError>("option '/", arg.substr(1, namelen), "' expected a value");
+                }
+                owner->m_schema->callbacks[decl].invoke(arg.substr(colpos + 1));
+            }
+            else
+            {
+                owner->m_schema->callbacks[decl].invoke();
             }
+            return true;
         }
 
         /*
         * parse an argument string that matches the pattern of
         * a long option, extract its values (if any), and invoke callbacks.
         * AFAIK long options can't be combined in GNU getopt, so neither does this function.
+        * nothing is copied, except for the names of unknown options.
         */
-        void parse_longoption(const string& argstring, size_t& iref)
+        void parse_longoption(const ParseContext& ctx, string_view argstring, size_t& iref) const
         {
-            size_t idx;
-			size_t eqpos;
-            string name;
-            string nodash;
-            string value;
-            Declaration decl;
-            nodash = argstring.substr(2);
+            size_t eqpos;
+            size_t namelen;
+            bool negated;
+            uint32_t decl;
+            const BasicOptionParser* owner;
             eqpos = argstring.find_first_of('=');
             if(eqpos == string::npos)
             {
-                name = nodash;
+                namelen = (argstring.size() - 2);
             }
             else
             {
-                /* get name by cutting nodash until eqpos */
-                name = nodash.substr(0, eqpos - 2);
+                namelen = (eqpos - 2);
+            }
+            decl = resolve_long(ctx, argstring.data() + 2, namelen, owner, negated);
+            /*
+            * "--no-color=yes" would otherwise just turn color off: a value means nothing
+            * to either form of a negatable option.
+            */
+            if((decl != npos) && (eqpos != string::npos) && (owner->m_schema->declflags[decl] & DECL_NEGATABLE))
+            {
+                throwError<InvalidOptionError>("option '", argstring.substr(2, namelen), "' does not take a value");
             }
-            if(find_decl_long(name, decl, idx))
+            if(negated)
             {
-                if(decl.needvalue)
+                owner->m_schema->callbacks[decl].invoke_toggle(false);
+                return;
+            }
+            if((decl == npos) && (dispatchflags(ctx, charat(argstring, 2)) & DispatchTable::DISPATCH_LONGFAMILY) && parse_family(ctx, argstring))
+            {
+                return;
+            }
+            if(decl == npos)
+            {
+                decl = resolve_abbrev(ctx, argstring.data() + 2, namelen, owner);
+            }
+            if(decl != npos)
+            {
+                if((owner->m_schema->declflags[decl] & DECL_NEEDVALUE))
                 {
                     if(eqpos == string::npos)
                     {
-                        throwError<ValueNeededError>("option '", name, "' expected a value");
+                        throwError<ValueNeededError>("option '", argstring.substr(2, namelen), "' expected a value");
                     }
                     else
                     {
-                        /* get value by cutting nodash after eqpos */
-                        value = nodash.substr(eqpos-1);
-                        decl.callback.invoke(value);
+                        /* value is everything after eqpos */
+                        owner->m_schema->callbacks[decl].invoke(argstring.substr(eqpos + 1));
                     }
                 }
                 else
                 {
-                    decl.callback.invoke();
+                    owner->m_schema->callbacks[decl].invoke();
                 }
             }
             else
             {
                 // invoke_on_unknown: longoption
-                invoke_or_throw<InvalidOptionError>(name, iref, 0, "unknown option '", name, "'");
+                string name(argstring.substr(2, namelen));
+                invoke_or_throw<InvalidOptionError>(ctx, name, iref, 0, "unknown option '", name, "'");
+            }
+        }
+
+        /*
+        * creates the parser of $cmd, a subcommand declared in $schema, and has its
+        * factory declare its options.
+        */
+        static void buildCommand(const std::shared_ptr<Schema>& schema, Command& cmd)
+        {
+            BasicOptionParser* sub;
+            cmd.parser.reset(new BasicOptionParser(schema->declhelp));
+            sub = cmd.parser.get();
+            sub->m_schema->parent = schema;
+            if(cmd.factory)
+            {
+                cmd.factory(*sub);
             }
         }
 
-        bool realparse()
+        /*
+        * returns the parser of command $idx, as declared in the schema. it is
+        * created the first time it is needed, so factories of commands that are
+        * never used never run. a frozen schema has created all of them already.
+        */
+        inline BasicOptionParser* commandParser(size_t idx) const
         {
-            size_t i;
-            bool stopparsing;
-            string nodash;
-            stopparsing = false;
-            for(i=0; i<m_vargs.size(); i++)
+            Command& cmd = m_schema->commands[idx];
+            if(m_schema->frozen)
             {
+                return cmd.parser.get();
+            }
+            std::lock_guard<std::mutex> lock(m_schema->commandlock);
+            if(!cmd.parser)
+            {
+                buildCommand(m_schema, cmd);
+            }
+            return cmd.parser.get();
+        }
 
-                for(auto iter=m_stopif_funcs.begin(); iter!=m_stopif_funcs.end(); iter++)
+        /*
+        * replaces $from with $to in the enclosing parsers of every subcommand run kept
+        * in m_commands, and theirs - so that a subcommand that is still being fed
+        * arguments (see feed()) finds the options of a moved parser.
+        */
+        void replaceOuter(const BasicOptionParser* from, const BasicOptionParser* to)
+        {
+            size_t i;
+            size_t j;
+            for(i=0; i<m_commands.size(); i++)
+            {
+                if(m_commands[i])
                 {
-                    if((*iter)(*this))
+                    std::vector<const BasicOptionParser*>& outer = m_commands[i]->m_ctx.m_outer;
+                    for(j=0; j<outer.size(); j++)
                     {
-                        stopparsing = true;
-                        break;
+                        if(outer[j] == from)
+                        {
+                            outer[j] = to;
+                        }
                     }
+                    m_commands[i]->replaceOuter(from, to);
+                }
+            }
+        }
+
+        /*
+        * returns the parser of command $idx that parse() without a ParseContext uses,
+        * creating it first, if needed. see m_commands.
+        */
+        BasicOptionParser* ownCommandParser(size_t idx) const
+        {
+            if(m_commands.size() <= idx)
+            {
+                m_commands.resize(m_schema->commands.size());
+            }
+            if(!m_commands[idx])
+            {
+                m_commands[idx].reset(new BasicOptionParser(commandParser(idx)->m_schema, nullptr));
+                // the subcommand of a frozen parser is just as frozen
+                m_commands[idx]->m_frozen = commandParser(idx)->m_frozen;
+            }
+            return m_commands[idx].get();
+        }
+
+        /*
+        * if $ctx.m_vargs[iref] names a subcommand, hands all remaining arguments to
+        * its parser. afterwards, $iref points past the last argument.
+        * the subcommand is parsed into ParseContext::m_command - except for parse()
+        * without a ParseContext, which keeps storing it in m_ctx of its own
+        * subcommand parser (see m_commands).
+        */
+        bool parse_command(ParseContext& ctx, size_t& iref) const
+        {
+            uint32_t idx;
+            BasicOptionParser* sub;
+            ParseContext* subctx;
+            idx = m_schema->commandindex.find(m_schema->nametable.data(), ctx.m_vargs[iref].data(), ctx.m_vargs[iref].size());
+            if(idx == npos)
+            {
+                return false;
+            }
+            ctx.m_commandidx = idx;
+            ctx.m_commandname = m_schema->commands[idx].name;
+            if(&ctx == &m_ctx)
+            {
+                /*
+                * the subcommand parser keeps its state past the next parse() of this
+                * one, which may discard the strings the arguments point into.
+                */
+                sub = ownCommandParser(idx);
+                subctx = &sub->m_ctx;
+                subctx->copyargs(ctx.m_vargs.begin() + (iref + 1), ctx.m_vargs.end());
+            }
+            else
+            {
+                sub = commandParser(idx);
+                if(!ctx.m_command)
+                {
+                    ctx.m_command.reset(new ParseContext);
+                }
+                subctx = ctx.m_command.get();
+                subctx->reset();
+                subctx->m_vargs.assign(ctx.m_vargs.begin() + (iref + 1), ctx.m_vargs.end());
+            }
+            subctx->m_outer = ctx.m_outer;
+            subctx->m_outer.push_back(this);
+            iref = ctx.m_vargs.size();
+            sub->beginrun(*subctx);
+            // arguments fed after this one go to the subcommand
+            subctx->m_feeding = ctx.m_feeding;
+            sub->continueparse(*subctx);
+            return true;
+        }
+
+        /*
+        * returns the parser of the subcommand $ctx has seen, and stores its context in $subctx.
+        */
+        BasicOptionParser* commandstate(ParseContext& ctx, ParseContext*& subctx) const
+        {
+            BasicOptionParser* sub;
+            if(&ctx == &m_ctx)
+            {
+                sub = ownCommandParser(ctx.m_commandidx);
+                subctx = &sub->m_ctx;
+            }
+            else
+            {
+                sub = commandParser(ctx.m_commandidx);
+                subctx = ctx.m_command.get();
+            }
+            return sub;
+        }
+
+        /*
+        * returns true if any of the stop_if callbacks says so.
+        * callbacks declared as StopIfCallback only see the parser itself.
+        */
+        bool shouldstop(const ParseContext& ctx) const
+        {
+            size_t i;
+            for(i=0; i<m_schema->stopif_ctxfuncs.size(); i++)
+            {
+                if(m_schema->stopif_ctxfuncs[i](ctx))
+                {
+                    return true;
+                }
+            }
+            for(i=0; i<m_schema->stopif_funcs.size(); i++)
+            {
+                if(m_schema->stopif_funcs[i](const_cast<BasicOptionParser&>(*this)))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // begins a run on $ctx, whose arguments are yet to be parsed.
+        void beginrun(ParseContext& ctx) const
+        {
+            ctx.m_next = 0;
+            ctx.m_posbegin = ctx.m_positional.size();
+            ctx.m_stopparsing = false;
+            ctx.m_waiting = false;
+            ctx.m_commandidx = npos;
+            ctx.m_commandname.clear();
+        }
+
+        // parses all arguments of $ctx at once.
+        bool realparse(ParseContext& ctx) const
+        {
+            ctx.m_feeding = false;
+            beginrun(ctx);
+            return continueparse(ctx);
+        }
+
+        /*
+        * parses the arguments of $ctx from ParseContext::m_next on, as far as possible.
+        * when fed one at a time, the last one may have to wait for the next (see waitfornext()).
+        */
+        bool continueparse(ParseContext& ctx) const
+        {
+            size_t i;
+            size_t cplen;
+            uint32_t cp;
+            uint8_t flags;
+            bool singledashlong;
+            bool dosopts;
+            ctx.m_waiting = false;
+            singledashlong = enclosingsetting(ctx, &Schema::singledashlong);
+            dosopts = enclosingsetting(ctx, &Schema::dosoptsdeclared);
+            for(i=ctx.m_next; (i<ctx.m_vargs.size()) && !ctx.m_waiting; i++)
+            {
+                if(!ctx.m_stopparsing && shouldstop(ctx))
+                {
+                    ctx.m_stopparsing = true;
                 }
                 /*
                 * GNU behavior feature: double-dash means to stop parsing arguments, but
                 * only if it wasn't signalled already by stop_if
                 */
-                if((m_vargs[i] == "--") && (stopparsing == false))
+                if((ctx.m_vargs[i] == "--") && (ctx.m_stopparsing == false))
                 {
-                    stopparsing = true;
+                    ctx.m_stopparsing = true;
                     continue;
                 }
-                if(stopparsing)
+                if(ctx.m_stopparsing)
                 {
-                    m_positional.push_back(m_vargs[i]);
+                    ctx.m_positional.push_back(ctx.m_vargs[i]);
                 }
                 else
                 {
-                    if(m_vargs[i][0] == '-')
+                    if(charat(ctx.m_vargs[i], 0) == '-')
                     {
                         /* arg starts with "--", so it's a long option. */
-                        if(m_vargs[i][1] == '-')
+                        if(charat(ctx.m_vargs[i], 1) == '-')
                         {
-                            parse_longoption(m_vargs[i], i);
+                            parse_longoption(ctx, ctx.m_vargs[i], i);
                         }
                         else
                         {
-                            nodash = m_vargs[i].substr(1);
                             /*
-                            * arg starts with "-", but has more than one character.
-                            * in this case, it could be combined options without arguments
-                            * (something like '-v' for verbose, '-d' for debug, etc),
-                            * but it could also be an option with argument, i.e., '-ofoo',
-                            * where '-o' is the option, and 'foo' is the value.
+                            * one look at the first character of the name tells which of the
+                            * lookups below could match at all; the others are skipped.
+                            * (for "-", this is NUL.)
+                            */
+                            flags = dispatchflags(ctx, charat(ctx.m_vargs[i], 1));
+                            /*
+                            * in LLVM mode, the whole word is tried as long option first, since
+                            * that is the longest possible interpretation of it.
+                            */
+                            if(singledashlong && (flags & DispatchTable::DISPATCH_LONG) && (ctx.m_vargs[i].size() > 2) && parse_singledashlong(ctx, ctx.m_vargs[i], i))
+                            {
+                                continue;
+                            }
+                            /*
+                            * prefix families take precedence over short options, since
+                            * "-Wall" is never meant as "-W -a -l -l".
                             */
-                            if(nodash.size() > 1)
+                            else if((flags & DispatchTable::DISPATCH_FAMILY) && parse_family(ctx, ctx.m_vargs[i]))
                             {
-                                parse_multishort(nodash, i);
+                                continue;
+                            }
+                            else if((flags & DispatchTable::DISPATCH_NUMERIC) && parse_numeric(ctx, ctx.m_vargs[i]))
+                            {
+                                continue;
                             }
                             else
                             {
                                 /*
-                                * process simple short option (e.g., "-ofoo", but also "-o" "foo")
-                                * by passing current index as reference.
-                                * that is, parse_simpleshort may increase index if option
-                                * requires a value, otherwise i remains as-is.
+                                * arg starts with "-", but has more than one character.
+                                * in this case, it could be combined options without arguments
+                                * (something like '-v' for verbose, '-d' for debug, etc),
+                                * but it could also be an option with argument, i.e., '-ofoo',
+                                * where '-o' is the option, and 'foo' is the value.
+                                * "character" meaning code point, so a UTF-8 encoded letter is still a single option.
                                 */
-                                parse_simpleshort(nodash[0], i);
+                                if(ctx.m_vargs[i].size() > 1)
+                                {
+                                    cp = decodechar(ctx.m_vargs[i].data() + 1, ctx.m_vargs[i].size() - 1, cplen);
+                                }
+                                else
+                                {
+                                    /*
+                                    * "-" has no name to decode, and its view need not be followed
+                                    * by a NUL (or anything at all). its code point is NUL.
+                                    */
+                                    cp = 0;
+                                    cplen = 1;
+                                }
+                                if(ctx.m_vargs[i].size() > (cplen + 1))
+                                {
+                                    parse_multishort(ctx, ctx.m_vargs[i], i);
+                                }
+                                else
+                                {
+                                    /*
+                                    * process simple short option (e.g., "-ofoo", but also "-o" "foo")
+                                    * by passing current index as reference.
+                                    * that is, parse_simpleshort may increase index if option
+                                    * requires a value, otherwise i remains as-is.
+                                    */
+                                    parse_simpleshort(ctx, ctx.m_vargs[i], cp, i);
+                                }
                             }
                         }
                     }
                     /*
-                    * todo: DOS style command parsing:
-                    * only process if any DOS style options were actually declared, since
-                    * this is going to cause all sorts of mixups with positional arguments.
-                    * additionally, process invalid and/or unknown DOS options as positional
-                    * arguments, since this is more or less what windows seems to do
+                    * DOS style options: only processed if any DOS style options were
+                    * actually declared, since this is going to cause all sorts of mixups
+                    * with positional arguments.
+                    * invalid and/or unknown DOS options are positional arguments, since
+                    * this is more or less what windows seems to do.
                     */
-                    /*
-                    if(m_dosoptsdeclared)
+                    else if(dosopts && (charat(ctx.m_vargs[i], 0) == '/') && parse_dosoption(ctx, ctx.m_vargs[i]))
                     {
-                        ...
+                        continue;
                     }
+                    /*
+                    * the first positional argument may name a subcommand, which then
+                    * takes over all remaining arguments.
                     */
+                    else if((m_schema->commandindex.size() > 0) && (ctx.m_positional.size() == ctx.m_posbegin) && parse_command(ctx, i))
+                    {
+                        break;
+                    }
                     else
                     {
-                        m_positional.push_back(m_vargs[i]);
+                        ctx.m_positional.push_back(ctx.m_vargs[i]);
                     }
                 }
             }
+            // if waiting, waitfornext() already pointed m_next at the argument that waits
+            if(!ctx.m_waiting)
+            {
+                ctx.m_next = i;
+            }
+            return true;
+        }
+
+        /*
+        * appends $arg to the run on $ctx (or of its subcommand, if one was seen), and
+        * parses as far as possible.
+        */
+        bool feedrun(ParseContext& ctx, string_view arg) const
+        {
+            ParseContext* subctx;
+            if(ctx.m_commandidx != npos)
+            {
+                return commandstate(ctx, subctx)->feedrun(*subctx, arg);
+            }
+            ctx.appendarg(arg);
+            return continueparse(ctx);
+        }
+
+        /*
+        * ends the run on $ctx (and of its subcommand, if one was seen): the argument
+        * that waits for another one, if any, is parsed without it.
+        */
+        bool finishrun(ParseContext& ctx) const
+        {
+            ParseContext* subctx;
+            ctx.m_feeding = false;
+            continueparse(ctx);
+            if(ctx.m_commandidx != npos)
+            {
+                return commandstate(ctx, subctx)->finishrun(*subctx);
+            }
             return true;
         }
 
@@ -1066,56 +4433,145 @@ class BasicOptionParser
         * todo: cuddle short options that take no arguments
         */
         template<typename StreamT>
-        StreamT& help_declarations_short(StreamT& buf) const
+        static StreamT& help_declarations_short(StreamT& buf, const Schema& schema)
         {
             size_t i;
-            for(i=0; i<m_declarations.size(); i++)
+            bool first;
+            first = true;
+            for(i=0; i<schema.declarations.size(); i++)
             {
-                buf << "[" << m_declarations[i]->to_short_str() << "]";
-                if((i + 1) != m_declarations.size())
+                // declarations without names (i.e., on({}, ...)) are neither shown, nor separated
+                if(schema.declarations[i]->firstname == npos)
+                {
+                    continue;
+                }
+                if(!first)
                 {
                     buf << " ";
                 }
+                buf << "[" << schema.declarations[i]->to_short_str() << "]";
+                first = false;
+            }
+            return buf;
+        }
+
+        template<typename StreamT>
+        static StreamT& help_declarations_long(StreamT& buf, const Schema& schema)
+        {
+            size_t i;
+            for(i=0; i<schema.declarations.size(); i++)
+            {
+                if(schema.declarations[i]->firstname == npos)
+                {
+                    continue;
+                }
+                buf << schema.declarations[i]->to_long_str() << std::endl;
             }
             return buf;
         }
 
+        // same layout as Declaration::to_long_str().
         template<typename StreamT>
-        StreamT& help_declarations_long(StreamT& buf) const
+        static StreamT& help_commands(StreamT& buf, const Schema& schema, size_t padsize=35)
         {
             size_t i;
-            for(i=0; i<m_declarations.size(); i++)
+            size_t pad;
+            for(i=0; i<schema.commands.size(); i++)
+            {
+                buf << "  " << schema.commands[i].name << ":";
+                pad = (schema.commands[i].name.size() + 3);
+                do
+                {
+                    buf << " ";
+                    pad++;
+                } while(pad < padsize);
+                buf << schema.commands[i].description << std::endl;
+            }
+            return buf;
+        }
+
+        /*
+        * renders the help text of $schema. see help().
+        */
+        template<typename StreamT>
+        static StreamT& help_schema(StreamT& buf, const Schema& schema)
+        {
+            if(schema.frozen)
+            {
+                buf << schema.helptext;
+                return buf;
+            }
+            buf << schema.helpbanner.str() << std::endl;
+            buf << "usage: ";
+            help_declarations_short(buf, schema);
+            buf << " <args ...>" << std::endl << std::endl;
+            buf << "available options:" << std::endl;
+            help_declarations_long(buf, schema);
+            if(!schema.commands.empty())
+            {
+                buf << std::endl << "available commands:" << std::endl;
+                help_commands(buf, schema);
+            }
+            if(auto parentschema = schema.parent.lock())
             {
-                buf << m_declarations[i]->to_long_str() << std::endl;
+                buf << std::endl << "global options:" << std::endl;
+                help_declarations_long(buf, *parentschema);
             }
+            buf << schema.helptail.str() << std::endl;
             return buf;
         }
 
+        /*
+        * the callback of "-h"/"--help". it refers to $schema rather than the parser,
+        * since the schema may be shared with clones.
+        */
+        static CallbackNoValue helpCallback(const Schema& schema)
+        {
+            const Schema* sp;
+            sp = &schema;
+            return [sp]
+            {
+                help_schema(std::cout, *sp);
+                std::exit(0);
+            };
+        }
+
         void init(bool declhelp)
         {
+            m_schema = std::make_shared<Schema>();
+            m_schema->declhelp = declhelp;
             if(declhelp)
             {
-                this->on({"-h", "--help"}, "show this help", [&]
-                {
-                    this->help(std::cout);
-                    std::exit(0);
-                });
+                this->on({"-h", "--help"}, "show this help", helpCallback(*m_schema));
             }
         }
 
     #if defined(__cplusplus_cli)
     public:
+        // appends $v to the arguments of the next cliboilerplate_realparse(), like feed() does.
         void cliboilerplate_pushvarg(const string& v)
         {
-            m_vargs.push_back(v);
+            m_ctx.appendarg(v);
         }
         /*
         * realparse() is intended to be protected - but C++CLR won't let me touch its privates.
         * bummer
+        * the pushed arguments are dropped afterwards, so that the next run begins with none.
         */
         bool cliboilerplate_realparse()
         {
-            return realparse();
+            bool res;
+            try
+            {
+                res = realparse(m_ctx);
+            }
+            catch(...)
+            {
+                m_ctx.clearargs();
+                throw;
+            }
+            m_ctx.clearargs();
+            return res;
         }
     #endif
 
@@ -1128,15 +4584,77 @@ class BasicOptionParser
         */
         BasicOptionParser(bool declhelp=true)
         {
-            init(declhelp);
+            init(declhelp);
+        }
+
+    protected:
+        // used by clone(): shares $schema, until either parser modifies it.
+        BasicOptionParser(const std::shared_ptr<Schema>& schema, const StaticLookup* lookup): m_schema(schema), m_staticlookup(lookup)
+        {
+        }
+
+        /*
+        * used by BasicStaticOptionParser: the help option is part of $schema, so
+        * unlike init(), this declares nothing but the options of $schema.
+        */
+        template<typename SchemaT>
+        BasicOptionParser(const SchemaT& schema, const StaticLookup* lookup, bool declhelp)
+        {
+            m_schema = std::make_shared<Schema>();
+            m_schema->declhelp = declhelp;
+            addStaticDeclarations(schema, lookup);
+        }
+
+    public:
+
+        /*
+        * copying would mean copying every declaration and callback - use clone() instead.
+        */
+        BasicOptionParser(const BasicOptionParser&) = delete;
+        BasicOptionParser& operator=(const BasicOptionParser&) = delete;
+
+        /**
+        * moves $other - its declarations, and the state of its last parse() - into a new
+        * parser, so that clones, and parsers returned by load(), can be returned from
+        * functions, and kept in containers. $other may only be destroyed afterwards.
+        */
+        BasicOptionParser(BasicOptionParser&& other) noexcept:
+            m_ctx(std::move(other.m_ctx)),
+            m_commands(std::move(other.m_commands)),
+            m_schema(std::move(other.m_schema)),
+            m_frozen(other.m_frozen),
+            m_staticlookup(other.m_staticlookup)
+        {
+            size_t i;
+            // alias() reaches the parser through its declarations
+            for(i=0; (m_schema != nullptr) && (i<m_schema->declarations.size()); i++)
+            {
+                if(m_schema->declarations[i]->selfref == &other)
+                {
+                    m_schema->declarations[i]->selfref = this;
+                }
+            }
+            replaceOuter(&other, this);
+        }
+
+        virtual ~BasicOptionParser()
+        {
         }
 
-        virtual ~BasicOptionParser()
+        /**
+        * returns a parser with the same declarations, settings and callbacks.
+        * this is cheap, regardless of the number of declarations: the schema is
+        * shared until either parser is modified, which gives that parser its own
+        * copy. modifying a clone therefore never affects the original, or vice versa.
+        * a clone of a frozen parser is not frozen itself, so declarations may be
+        * added to it.
+        * note that references returned by on() refer to the schema at the time; once
+        * the parser copied it, alias() still works, but only as long as the original
+        * schema is alive.
+        */
+        BasicOptionParser clone() const
         {
-            for(auto decl: m_declarations)
-            {
-                delete decl;
-            }
+            return BasicOptionParser(m_schema, m_staticlookup);
         }
 
         /**
@@ -1172,6 +4690,99 @@ class BasicOptionParser
             return addDeclaration(strs, desc, Callback(fn));
         }
 
+        /**
+        * declare a negatable option: in addition to its long names, "--no-<name>" is
+        * accepted for each of them. $fn receives true for "--<name>" (and for short
+        * options), and false for "--no-<name>".
+        * the negated names cost nothing extra; they are resolved through the index
+        * entry of the positive name. help() shows both as "--[no-]<name>".
+        * the options must not take a value; passing one anyway, like "--no-color=yes",
+        * raises InvalidOptionError.
+        *
+        *   prs.onNegatable({"-c", "--color"}, "colorize output", [&](bool on)
+        *   {
+        *       usecolor = on;
+        *   });
+        */
+        Declaration& onNegatable(const std::vector<string>& strs, const string& desc, CallbackToggle fn)
+        {
+            return addDeclaration(strs, desc, Callback(fn), DECL_NEGATABLE);
+        }
+
+        /**
+        * declare a numeric family: every prefix in $prefixes, followed by nothing but
+        * digits, invokes $fn with the number, already decoded as integer.
+        *
+        * @param prefixes   either a dash followed by a single character, i.e., {"-O", "-j"}
+        *                   for "-O3" and "-j16", or just a dash, i.e., {"-"}, for bare numeric
+        *                   flags like "-0" through "-9" (or "-15", for that matter).
+        *
+        * arguments starting with a prefix, but not followed by digits only (i.e., "-Ofast")
+        * are parsed as usual. numbers that don't fit a long long raise ValueConversionError.
+        * numeric families take precedence over short options, so a short option "-0"
+        * is shadowed by onNumber({"-"}, ...).
+        */
+        Declaration& onNumber(const std::vector<string>& prefixes, const string& desc, CallbackNumeric fn)
+        {
+            size_t i;
+            Declaration* decl;
+            ensureMutable();
+            for(i=0; i<prefixes.size(); i++)
+            {
+                if((prefixes[i].size() == 0) || (prefixes[i].size() > 2) || (prefixes[i][0] != '-') ||
+                   ((prefixes[i].size() == 2) && (!isalphanum(prefixes[i][1]) || ((prefixes[i][1] >= '0') && (prefixes[i][1] <= '9')))))
+                {
+                    throwError<Error>("invalid numeric family prefix '", prefixes[i], "'");
+                }
+            }
+            decl = newDeclaration(desc.data(), desc.size());
+            commitDeclaration(decl, 0, Callback(fn));
+            for(i=0; i<prefixes.size(); i++)
+            {
+                addName(decl, prefixes[i].data(), prefixes[i].size(), NameRef::NUMERIC, true);
+            }
+            return *decl;
+        }
+
+        /**
+        * declare a subcommand (like "git commit", or "docker run").
+        * if $name is the first positional argument, every argument after it is
+        * parsed by the parser of the subcommand instead. that parser is only created
+        * when $name is first seen (or by freeze()), and $factory declares its options
+        * then - so subcommands that are never used cost nothing but their name:
+        *
+        *   prs.onCommand("commit", "record changes", [&](OptionParser& sub)
+        *   {
+        *       sub.on({"-m?", "--message=?"}, "commit message", [&](const auto& v){ ... });
+        *   });
+        *
+        * options of this parser remain valid after the subcommand (they are looked up
+        * after the ones of the subcommand), and subcommands may declare subcommands
+        * of their own. afterwards, command() and commandName() tell which subcommand
+        * was used; its positional arguments are in command()->positional().
+        */
+        void onCommand(const string& name, const string& desc, CommandFactory factory)
+        {
+            uint32_t offset;
+            Command cmd;
+            ensureMutable();
+            if(name.empty())
+            {
+                throwError<Error>("command name must not be empty");
+            }
+            if(m_schema->commandindex.find(m_schema->nametable.data(), name.data(), name.size()) != npos)
+            {
+                throwError<Error>("command '", name, "' declared twice");
+            }
+            cmd.name = name;
+            cmd.description = desc;
+            cmd.factory = factory;
+            offset = uint32_t(m_schema->nametable.size());
+            m_schema->nametable.append(name);
+            m_schema->commandindex.insert(m_schema->nametable.data(), offset, uint32_t(name.size()), uint32_t(m_schema->commands.size()));
+            m_schema->commands.push_back(std::move(cmd));
+        }
+
         /***
         * declare a callback that is called whenever an unknown/undeclared option flag
         * is encountered.
@@ -1192,7 +4803,174 @@ class BasicOptionParser
         */
         void onUnknownOption(UnknownOptCallback fn)
         {
-            m_on_unknownoptfn = fn;
+            ensureMutable();
+            m_schema->on_unknownoptfn = fn;
+        }
+
+        /**
+        * allow abbreviated long options, like GNU getopt_long does.
+        * if enabled, "--verb" is accepted for "--verbose", as long as no long option
+        * of another declaration starts with "verb" as well. exact matches always take
+        * precedence, so "--verb" would still be used if it was declared.
+        * ambiguous abbreviations raise AmbiguousOptionError, listing all candidates.
+        * disabled by default.
+        */
+        void allowAbbreviations(bool allow=true)
+        {
+            ensureMutable();
+            // names declared before the trie was first needed (see addName())
+            if(allow && !m_schema->allowabbrev && m_schema->abbrevtrie.empty())
+            {
+                for(const auto& ref: m_schema->names)
+                {
+                    if(ref.kind == NameRef::GNU)
+                    {
+                        m_schema->abbrevtrie.insert(m_schema->nametable.data() + ref.offset, ref.length, ref.decl);
+                    }
+                }
+            }
+            m_schema->allowabbrev = allow;
+        }
+
+        /**
+        * allow LLVM style long options, with a single dash, i.e., "-use-whatever"
+        * for a declared "--use-whatever". the word after the dash is first looked up
+        * as long option (as a whole, or up to '=', for "-out=foo"), and only if
+        * that fails, parsed as short option(s). values of such options may also
+        * be passed as next argument ("-out foo").
+        * single-character words ("-v") are always short options.
+        * disabled by default. once allowed, it applies to subcommands as well.
+        */
+        void allowSingleDashLong(bool allow=true)
+        {
+            ensureMutable();
+            m_schema->singledashlong = allow;
+        }
+
+        /**
+        * compiles the parser into its final, read-only form: every subcommand is
+        * frozen as well, the help text is rendered once, and all tables are trimmed
+        * to their actual size.
+        * afterwards, anything that would change the declarations throws Error,
+        * and parse() only ever reads the compiled schema, so it can be shared by
+        * any number of parse runs without being rebuilt or validated again.
+        * freezing an already frozen parser does nothing.
+        */
+        void freeze()
+        {
+            size_t i;
+            stringstream buf;
+            if(m_frozen)
+            {
+                return;
+            }
+            m_frozen = true;
+            // a clone of a frozen parser may share its schema as-is
+            if(m_schema->frozen)
+            {
+                return;
+            }
+            if(m_schema.use_count() > 1)
+            {
+                detachSchema();
+            }
+            for(i=0; i<m_schema->commands.size(); i++)
+            {
+                commandParser(i)->freeze();
+            }
+            m_schema->compact();
+            help(buf);
+            m_schema->helptext = buf.str();
+            m_schema->frozen = true;
+        }
+
+        /**
+        * true if freeze() was called.
+        */
+        inline bool frozen() const
+        {
+            return m_frozen;
+        }
+
+        /**
+        * writes the schema of this parser - names, flags, lookup tables, and the help
+        * text - to $out, in a versioned binary format. load() maps it back in, which
+        * is far cheaper than declaring every option again.
+        * callbacks (as well as stopIf() and onUnknownOption() handlers) can't be stored;
+        * they are bound again by id after loading, see bind().
+        * the parser must be frozen, and must not have subcommands; otherwise, Error is thrown.
+        */
+        void save(std::ostream& out) const
+        {
+            if(!m_schema->frozen)
+            {
+                throwError<Error>("only frozen parsers can be saved");
+            }
+            if(!m_schema->commands.empty())
+            {
+                throwError<Error>("parsers with subcommands cannot be saved");
+            }
+            SchemaWriter w(out);
+            writeSchema(w, *m_schema);
+            if(!out.good())
+            {
+                throwError<IOError>("failed to write schema");
+            }
+        }
+
+        /**
+        * like save(std::ostream&), but writes to the file $path.
+        */
+        void save(const std::string& path) const
+        {
+            std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
+            if(!out.good())
+            {
+                throwError<IOError>("failed to open '", path, "' for writing");
+            }
+            save(out);
+        }
+
+        /**
+        * returns a parser for the schema file $path, written by save().
+        * the file is memory-mapped (where possible), and kept mapped as long as the schema
+        * is in use. nothing is parsed or hashed again - tables are taken as they are.
+        * the parser is not frozen, so that callbacks can be bound with bind(); declaring
+        * further options makes it copy the schema, like clone() would.
+        * throws IOError if the file can't be read, or was written by an incompatible
+        * version, or on an incompatible platform.
+        */
+        static BasicOptionParser load(const std::string& path)
+        {
+            return BasicOptionParser(readSchema(std::make_shared<const MappedFile>(path), path), nullptr);
+        }
+
+        /**
+        * sets the callback of the declaration with id $id. ids are assigned in order of
+        * declaration, starting at 0 - which is "-h"/"--help", unless disabled.
+        * mostly useful for parsers returned by load().
+        * throws Error if $id is out of range.
+        */
+        Declaration& bind(uint32_t id, CallbackWithValue fn)
+        {
+            return bindId(id, Callback(fn));
+        }
+
+        Declaration& bind(uint32_t id, CallbackNoValue fn)
+        {
+            return bindId(id, Callback(fn));
+        }
+
+        // like bind(), for declarations made by onNumber().
+        Declaration& bindNumber(uint32_t id, CallbackNumeric fn)
+        {
+            return bindId(id, Callback(fn));
+        }
+
+        // like bind(), for declarations made by onNegatable().
+        Declaration& bindNegatable(uint32_t id, CallbackToggle fn)
+        {
+            return bindId(id, Callback(fn));
         }
 
         /**
@@ -1201,7 +4979,8 @@ class BasicOptionParser
         */
         inline stringstream& banner()
         {
-            return m_helpbannerbuf;
+            ensureMutable();
+            return m_schema->helpbanner;
         }
 
         /**
@@ -1210,7 +4989,8 @@ class BasicOptionParser
         */
         inline stringstream& tail()
         {
-            return m_helptailbuf;
+            ensureMutable();
+            return m_schema->helptail;
         }
 
         /**
@@ -1223,14 +5003,7 @@ class BasicOptionParser
         template<typename StreamT>
         StreamT& help(StreamT& buf) const
         {
-            buf << m_helpbannerbuf.str() << std::endl;
-            buf << "usage: ";
-            help_declarations_short(buf);
-            buf << " <args ...>" << std::endl << std::endl;
-            buf << "available options:" << std::endl;
-            help_declarations_long(buf);
-            buf << m_helptailbuf.str() << std::endl;
-            return buf;
+            return help_schema(buf, *m_schema);
         }
 
         /**
@@ -1247,7 +5020,7 @@ class BasicOptionParser
         */
         inline std::vector<string> positional() const
         {
-            return m_positional;
+            return std::vector<string>(m_ctx.m_positional.begin(), m_ctx.m_positional.end());
         }
 
         /**
@@ -1255,7 +5028,7 @@ class BasicOptionParser
         */
         inline std::string positional(size_t idx) const
         {
-            return m_positional[idx];
+            return std::string(m_ctx.m_positional[idx]);
         }
 
         /**
@@ -1263,7 +5036,7 @@ class BasicOptionParser
         */
         inline size_t size() const
         {
-            return m_positional.size();
+            return m_ctx.m_positional.size();
         }
 
         /**
@@ -1274,6 +5047,27 @@ class BasicOptionParser
             return this->size();
         }
 
+        /**
+        * returns the parser of the subcommand seen by the last parse(), or nullptr.
+        * it belongs to this parser alone - clones have subcommand parsers of their own.
+        */
+        inline BasicOptionParser* command() const
+        {
+            if((m_ctx.m_commandidx == npos) || (m_ctx.m_commandidx >= m_commands.size()))
+            {
+                return nullptr;
+            }
+            return m_commands[m_ctx.m_commandidx].get();
+        }
+
+        /**
+        * returns the name of the subcommand seen by the last parse(), or an empty string.
+        */
+        inline string commandName() const
+        {
+            return m_ctx.m_commandname;
+        }
+
         /**
         * add a function that is called prior to each parsing loop, determining
         * whether or not to stop parsing.
@@ -1281,7 +5075,19 @@ class BasicOptionParser
         */
         inline void stopIf(StopIfCallback cb)
         {
-            m_stopif_funcs.push_back(cb);
+            ensureMutable();
+            m_schema->stopif_funcs.push_back(cb);
+        }
+
+        /**
+        * like stopIf(StopIfCallback), but the callback is passed the ParseContext
+        * of the run instead of the parser. prefer this one - with parse(ParseContext&, ...),
+        * a StopIfCallback only ever sees the state of parse() calls without a ParseContext.
+        */
+        inline void stopIf(StopIfContextCallback cb)
+        {
+            ensureMutable();
+            m_schema->stopif_ctxfuncs.push_back(cb);
         }
 
         /**
@@ -1301,15 +5107,35 @@ class BasicOptionParser
         */
         inline void stopIfSawPositional()
         {
-            this->stopIf([](BasicOptionParser& p)
+            this->stopIf(StopIfContextCallback([](const ParseContext& ctx)
+            {
+                return (ctx.size() > 0);
+            }));
+        }
+
+        /**
+        * discards the state of the last parse() - positional values, the subcommand
+        * seen, and its state - without releasing the memory it took, so that a parser
+        * that is used over and over again stops allocating once it has seen its
+        * largest run. without reset(), parse() adds to the positional values of the
+        * runs before it.
+        * parse(ParseContext&, ...) resets its ParseContext by itself.
+        */
+        void reset()
+        {
+            BasicOptionParser* sub;
+            if((sub = command()) != nullptr)
             {
-                return (p.size() > 0);
-            });
+                sub->reset();
+            }
+            m_ctx.reset();
         }
 
         /**
-        * populate m_vargs, and call the parser with argc/argv as it were passed
+        * populate m_ctx, and call the parser with argc/argv as it were passed
         * to main().
+        * the arguments are not copied: values passed to callbacks, and positional
+        * values point straight into argv, which hence must outlive the parser.
         *
         * @param argc    the argument vector count.
         * @param argv    the argument vector values.
@@ -1322,30 +5148,289 @@ class BasicOptionParser
         */
         bool parse(int argc, char** argv, int begin=1)
         {
-            int i;
-            m_vargs.reserve(argc + 1);
-            for(i=begin; i<argc; i++)
-            {
-                m_vargs.push_back(argv[i]);
-            }
-            return realparse();
+            m_ctx.borrowargs(argc, argv, begin);
+            return realparse(m_ctx);
         }
 
         /**
         * like parse(int, char**, int), but with a std::vector.
         * unlike parse(int, char**, int) however, it will assume that the
         * index starts at 0.
+        * since $args may not outlive the parser, they are copied; positional values
+        * are owned by the parser.
         */
         bool parse(const std::vector<string>& args)
         {
-            m_vargs = args;
-            return realparse();
+            m_ctx.copyargs(args.begin(), args.end());
+            return realparse(m_ctx);
+        }
+
+        /**
+        * like parse(const std::vector<string>&), but takes over the strings of $args
+        * instead of copying them. positional values are owned by the parser.
+        */
+        bool parse(std::vector<string>&& args)
+        {
+            m_ctx.storeargs(std::move(args));
+            return realparse(m_ctx);
+        }
+
+        /**
+        * like parse(int, char**, int), but with the strings of [$begin, $end), which may
+        * be anything a string_view can be made of: string, string_view, const CharT*, ...
+        * - i.e., the begin() and end() of a std::span.
+        * like argv, nothing is copied: values passed to callbacks, and positional values
+        * point into the strings of the range, which must outlive the parser (or its next
+        * parse()) for positional values to stay valid.
+        */
+        template<typename IterT>
+        bool parse(IterT begin, IterT end)
+        {
+            m_ctx.borrowargs(begin, end);
+            return realparse(m_ctx);
+        }
+
+        /**
+        * like parse(int, char**, int), but stores the state of the run in $ctx
+        * instead of the parser, which is not modified at all.
+        * any previous state of $ctx is discarded.
+        * as long as the parser is frozen, this may be called from any number of
+        * threads at once, each with their own ParseContext.
+        * like parse(int, char**, int), nothing is copied; reusing $ctx for the next
+        * run reuses its memory as well, so that a run allocates nothing, unless it
+        * sees more arguments or positional values than any run before it.
+        */
+        bool parse(ParseContext& ctx, int argc, char** argv, int begin=1) const
+        {
+            ctx.reset();
+            ctx.borrowargs(argc, argv, begin);
+            return realparse(ctx);
+        }
+
+        /**
+        * like parse(ParseContext&, int, char**, int), but with a std::vector,
+        * which is copied into $ctx. positional values are owned by $ctx.
+        */
+        bool parse(ParseContext& ctx, const std::vector<string>& args) const
+        {
+            ctx.reset();
+            ctx.copyargs(args.begin(), args.end());
+            return realparse(ctx);
+        }
+
+        /**
+        * like parse(ParseContext&, const std::vector<string>&), but takes over the
+        * strings of $args instead of copying them. positional values are owned by $ctx.
+        */
+        bool parse(ParseContext& ctx, std::vector<string>&& args) const
+        {
+            ctx.reset();
+            ctx.storeargs(std::move(args));
+            return realparse(ctx);
+        }
+
+        /**
+        * like parse(IterT, IterT), but stores the state of the run in $ctx.
+        * positional values point into the strings of the range.
+        */
+        template<typename IterT>
+        bool parse(ParseContext& ctx, IterT begin, IterT end) const
+        {
+            ctx.reset();
+            ctx.borrowargs(begin, end);
+            return realparse(ctx);
+        }
+
+        /**
+        * parses arguments one at a time, as they come in (i.e., from a socket): $arg is
+        * parsed right away, as far as possible, and callbacks are invoked as soon as
+        * their option is complete. an option that takes its value from the next
+        * argument (like "-o" "foo") waits for it.
+        * the first feed() begins a run, and finish() ends it - feeding all arguments,
+        * and then calling finish(), has the very same results (and errors) as a single
+        * parse() with all of them. like parse() without a ParseContext, positional
+        * values add to those of earlier runs, unless reset() is called.
+        * $arg is copied. a run that threw an error is over; the next feed() begins a new one.
+        */
+        bool feed(string_view arg)
+        {
+            if(!m_ctx.m_feeding)
+            {
+                m_ctx.clearargs();
+                beginrun(m_ctx);
+                m_ctx.m_feeding = true;
+            }
+            try
+            {
+                return feedrun(m_ctx, arg);
+            }
+            catch(...)
+            {
+                m_ctx.m_feeding = false;
+                throw;
+            }
+        }
+
+        /**
+        * ends the run begun by feed(): an option still waiting for its value
+        * raises ValueNeededError, just like it would at the end of parse().
+        */
+        bool finish()
+        {
+            if(!m_ctx.m_feeding)
+            {
+                m_ctx.clearargs();
+                beginrun(m_ctx);
+            }
+            return finishrun(m_ctx);
+        }
+
+        /**
+        * like feed(string_view), but stores the state of the run in $ctx.
+        * the first feed() into $ctx discards its previous state, like parse() would.
+        */
+        bool feed(ParseContext& ctx, string_view arg) const
+        {
+            if(!ctx.m_feeding)
+            {
+                ctx.reset();
+                beginrun(ctx);
+                ctx.m_feeding = true;
+            }
+            try
+            {
+                return feedrun(ctx, arg);
+            }
+            catch(...)
+            {
+                ctx.m_feeding = false;
+                throw;
+            }
+        }
+
+        /**
+        * like finish(), but for the run in $ctx.
+        */
+        bool finish(ParseContext& ctx) const
+        {
+            if(!ctx.m_feeding)
+            {
+                ctx.reset();
+                beginrun(ctx);
+            }
+            return finishrun(ctx);
+        }
+};
+
+/**
+* a BasicOptionParser whose declarations are compiled from a constexpr
+* array of StaticOption. the patterns are parsed at compile time (errors in them
+* are compile errors), and short and long options are resolved through perfect hashes,
+* so constructing one does not parse any patterns at all.
+* callbacks are bound at runtime by the index of the option in the array:
+*
+*   static constexpr OptionParser::StaticOption myoptions[] =
+*   {
+*       {{"-v", "--verbose"}, "increase verbosity"},
+*       {{"-o<file>", "--out=<file>"}, "set output file"},
+*   };
+*   StaticOptionParser<myoptions> prs;
+*   prs.bind(0, [&]{ verbose++; });
+*   prs.bind(1, [&](const auto& v){ outfile = v.str(); });
+*   prs.parse(argc, argv);
+*
+* the "-h" and "--help" of BasicOptionParser(bool) are compiled into the schema as
+* well, save for those names the array declares itself.
+* options declared through on() still work; they are looked up after the static ones.
+*/
+template<typename CharT, const auto& Options>
+class BasicStaticOptionParser: public BasicOptionParser<CharT>
+{
+    public:
+        using Base               = BasicOptionParser<CharT>;
+        using Declaration        = typename Base::Declaration;
+        using Callback           = typename Base::Callback;
+        using CallbackNoValue    = typename Base::CallbackNoValue;
+        using CallbackWithValue  = typename Base::CallbackWithValue;
+
+        static constexpr auto schema = Base::template compileSchema<Options>();
+
+    private:
+        static size_t lookup_short(CharT c)
+        {
+            return schema.find_short(c);
+        }
+
+        static size_t lookup_long(const CharT* name, size_t len)
+        {
+            return schema.find_long(name, len);
+        }
+
+        static size_t lookup_dos(const CharT* name, size_t len)
+        {
+            return schema.find_dos(name, len);
+        }
+
+        static constexpr typename Base::StaticLookup lookup = {lookup_short, lookup_long, lookup_dos};
+
+    protected:
+        // used by clone()
+        BasicStaticOptionParser(const std::shared_ptr<typename Base::Schema>& sch): Base(sch, &lookup)
+        {
+        }
+
+    public:
+        BasicStaticOptionParser(bool declhelp=true): Base(schema, &lookup, declhelp)
+        {
+        }
+
+        /**
+        * like BasicOptionParser::clone(). the static declarations keep their ids
+        * in the copy, so they are still resolved through the perfect hashes.
+        */
+        BasicStaticOptionParser clone() const
+        {
+            return BasicStaticOptionParser(this->m_schema);
+        }
+
+        /**
+        * sets the callback of the option at index $idx of Options.
+        * unlike BasicOptionParser::bind(), $idx is not a declaration id.
+        * throws Error if $idx is out of range.
+        */
+        Declaration& bind(size_t idx, CallbackWithValue fn)
+        {
+            return bindCallback(idx, Callback(fn));
+        }
+
+        Declaration& bind(size_t idx, CallbackNoValue fn)
+        {
+            return bindCallback(idx, Callback(fn));
+        }
+
+    private:
+        Declaration& bindCallback(size_t idx, Callback cb)
+        {
+            uint32_t decl;
+            if(idx >= std::size(Options))
+            {
+                throw typename Base::Error("static option index out of range");
+            }
+            // option 0 of the schema is the help option
+            decl = this->staticdecl(idx + 1);
+            this->ensureMutable();
+            this->m_schema->callbacks[decl] = cb;
+            this->m_schema->declarations[decl]->selfref = this;
+            return *(this->m_schema->declarations[decl]);
         }
 };
 
 /* in c++clr mode, OptionParser is defined in wrap.cpp */
 #if !defined(_OPTIONPARSER_CLRMODE)
 using OptionParser = BasicOptionParser<char>;
+
+template<const auto& Options>
+using StaticOptionParser = BasicStaticOptionParser<char, Options>;
 #endif
 
 // that's all, folks!
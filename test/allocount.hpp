@@ -0,0 +1,34 @@
+/*
+* replaces the global operator new and delete with ones that count every
+* allocation in g_allocations. used by noalloc and benchreuse.
+* since it defines these operators, it may only be included by a single
+* translation unit of a program.
+*/
+
+#pragma once
+#include <cstdlib>
+#include <new>
+
+static size_t g_allocations = 0;
+
+// not inlined, so that gcc does not take free() for the wrong way to release what operator new returned
+__attribute__((noinline)) void* operator new(size_t size)
+{
+    void* ptr;
+    g_allocations++;
+    if((ptr = std::malloc((size > 0) ? size : 1)) == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+__attribute__((noinline)) void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+__attribute__((noinline)) void operator delete(void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
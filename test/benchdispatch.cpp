@@ -0,0 +1,161 @@
+/*
+* parses argv-heavy workloads with a compiler driver like parser (short and long
+* options, prefix families, numeric options, LLVM style long options), and
+* reports the time per argument, dispatched through the DispatchTable as usual,
+* and with every lookup tried for every argument - which is what parsing did
+* before there was a DispatchTable.
+*/
+
+#include <iostream>
+#include <chrono>
+#include "optionparser.hpp"
+
+/*
+* a parser whose DispatchTable marks every character with every flag, so that
+* no lookup is ever skipped. the result of parsing is the same, since the flags
+* only tell which lookups may be skipped.
+*/
+class UndispatchedParser: public OptionParser
+{
+    public:
+        using OptionParser::OptionParser;
+
+        void tryEveryLookup()
+        {
+            m_schema->dispatch.markAll(
+                DispatchTable::DISPATCH_LONG |
+                DispatchTable::DISPATCH_FAMILY |
+                DispatchTable::DISPATCH_LONGFAMILY |
+                DispatchTable::DISPATCH_NUMERIC
+            );
+        }
+};
+
+struct Workload
+{
+    const char* name;
+    std::vector<std::string> args;
+};
+
+static size_t g_seen = 0;
+
+static void declare(OptionParser& prs)
+{
+    prs.allowSingleDashLong();
+    prs.on({"-v", "--verbose"}, "be verbose", []
+    {
+        g_seen++;
+    });
+    prs.on({"-c"}, "compile only", []
+    {
+        g_seen++;
+    });
+    prs.on({"-g"}, "debug info", []
+    {
+        g_seen++;
+    });
+    prs.on({"-o?", "--output=?"}, "output file", [](const OptionParser::Value& v)
+    {
+        g_seen += v.size();
+    });
+    prs.on({"-I?", "--include=?"}, "add an include path", [](const OptionParser::Value& v)
+    {
+        g_seen += v.size();
+    });
+    prs.on({"--std=?"}, "language standard", [](const OptionParser::Value& v)
+    {
+        g_seen += v.size();
+    });
+    prs.on({"-W*"}, "warnings", [](const OptionParser::Value& v)
+    {
+        g_seen += v.size();
+    });
+    prs.on({"-f*"}, "code generation flags", [](const OptionParser::Value& v)
+    {
+        g_seen += v.size();
+    });
+    prs.on({"-D*"}, "define a macro", [](const OptionParser::Value& v)
+    {
+        g_seen += v.size();
+    });
+    prs.onNumber({"-O"}, "optimization level", [](long long n)
+    {
+        g_seen += size_t(n);
+    });
+}
+
+/*
+* parses $wl $rounds times on $prs, and returns the time per argument, in nanoseconds.
+*/
+static double run(const OptionParser& prs, const Workload& wl, size_t rounds)
+{
+    size_t i;
+    double secs;
+    std::chrono::steady_clock::time_point begin;
+    OptionParser::ParseContext ctx;
+    prs.parse(ctx, wl.args.begin(), wl.args.end());
+    begin = std::chrono::steady_clock::now();
+    for(i=0; i<rounds; i++)
+    {
+        prs.parse(ctx, wl.args.begin(), wl.args.end());
+    }
+    secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    return ((secs * 1e9) / (rounds * wl.args.size()));
+}
+
+/*
+* repeats $args until there are $count of them.
+*/
+static std::vector<std::string> repeat(const std::vector<std::string>& args, size_t count)
+{
+    size_t i;
+    std::vector<std::string> res;
+    for(i=0; i<count; i++)
+    {
+        res.push_back(args[i % args.size()]);
+    }
+    return res;
+}
+
+int main()
+{
+    size_t i;
+    size_t seen;
+    size_t before;
+    double fast;
+    double slow;
+    static const size_t argcount = 10000;
+    static const size_t rounds = 500;
+    std::vector<Workload> workloads =
+    {
+        {"short options", repeat({"-v", "-cg", "-o", "main.o", "-vcg", "-Iinclude"}, argcount)},
+        {"long options", repeat({"--verbose", "--output=main.o", "--include=/usr/local/include", "--std=c++17"}, argcount)},
+        {"single-dash long options", repeat({"-std=c++17", "-verbose", "-output", "main.o"}, argcount)},
+        {"families, numeric", repeat({"-Wall", "-Wextra", "-O2", "-fno-exceptions", "-DNDEBUG=1", "-O3"}, argcount)},
+        {"positional", repeat({"src/main.cpp", "src/parser.cpp", "src/lexer.cpp", "lib/libfoo.a"}, argcount)},
+        {"compiler command line", repeat({"-c", "-O2", "-g", "-Wall", "-Iinclude", "-DDEBUG", "-std=c++17", "--output=main.o", "src/main.cpp"}, argcount)},
+    };
+    OptionParser prs(false);
+    UndispatchedParser undispatched(false);
+    declare(prs);
+    declare(undispatched);
+    undispatched.tryEveryLookup();
+    prs.freeze();
+    undispatched.freeze();
+    for(i=0; i<workloads.size(); i++)
+    {
+        before = g_seen;
+        fast = run(prs, workloads[i], rounds);
+        seen = (g_seen - before);
+        before = g_seen;
+        slow = run(undispatched, workloads[i], rounds);
+        // both must have invoked the same callbacks, with the same values
+        if((g_seen - before) != seen)
+        {
+            std::cerr << workloads[i].name << ": parsers disagree" << std::endl;
+            return 1;
+        }
+        std::cout << workloads[i].name << ": " << fast << "ns per argument, " << slow << "ns with every lookup tried" << std::endl;
+    }
+    return 0;
+}
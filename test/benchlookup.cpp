@@ -0,0 +1,55 @@
+/*
+* declares from 10 up to 10,000 long options ("--feature-0", "--feature-1", ...),
+* parses the same number of random ones from each, and reports the time per
+* long option. since long options are resolved through a hash index, it should
+* stay flat, no matter how many are declared.
+*/
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include "optionparser.hpp"
+
+int main()
+{
+    size_t i;
+    size_t j;
+    size_t round;
+    size_t seen;
+    double secs;
+    std::vector<std::string> args;
+    std::mt19937 rng(1234);
+    std::chrono::steady_clock::time_point begin;
+    static const std::vector<size_t> counts = {10, 100, 1000, 10000};
+    static const size_t argcount = 1000;
+    static const size_t rounds = 2000;
+    seen = 0;
+    for(j=0; j<counts.size(); j++)
+    {
+        OptionParser prs(false);
+        OptionParser::ParseContext ctx;
+        for(i=0; i<counts[j]; i++)
+        {
+            prs.on({"--feature-" + std::to_string(i)}, "enable a feature", [&]
+            {
+                seen++;
+            });
+        }
+        prs.freeze();
+        args.clear();
+        for(i=0; i<argcount; i++)
+        {
+            args.push_back("--feature-" + std::to_string(rng() % counts[j]));
+        }
+        // once, so that the context has seen its largest run
+        prs.parse(ctx, args.begin(), args.end());
+        begin = std::chrono::steady_clock::now();
+        for(round=0; round<rounds; round++)
+        {
+            prs.parse(ctx, args.begin(), args.end());
+        }
+        secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        std::cout << counts[j] << " long options declared: " << ((secs * 1e9) / (rounds * argcount)) << "ns per long option" << std::endl;
+    }
+    return (seen == (counts.size() * (rounds + 1) * argcount)) ? 0 : 1;
+}
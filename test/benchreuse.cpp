@@ -0,0 +1,99 @@
+/*
+* parses one million requests, like a command daemon would, on a single parser
+* that is reset() between them, and reports the time and the allocations per
+* request, once warmed up. for comparison, it also builds a new parser for each
+* of a smaller number of requests.
+*/
+
+#include <iostream>
+#include <chrono>
+#include "optionparser.hpp"
+#include "allocount.hpp"
+
+struct Request
+{
+    int verbose = 0;
+    bool dryrun = false;
+    size_t valuebytes = 0;
+};
+
+static void declare(OptionParser& prs, Request& req)
+{
+    // everything after the command to run belongs to it
+    prs.stopIfSawPositional();
+    prs.on({"-v", "--verbose"}, "be verbose", [&]
+    {
+        req.verbose++;
+    });
+    prs.on({"-n", "--dry-run"}, "do nothing", [&]
+    {
+        req.dryrun = true;
+    });
+    prs.on({"-u?", "--user=?"}, "run as user", [&](const OptionParser::Value& v)
+    {
+        req.valuebytes += v.size();
+    });
+    prs.on({"-t?", "--timeout=?"}, "give up after this many seconds", [&](const OptionParser::Value& v)
+    {
+        req.valuebytes += v.size();
+    });
+    prs.on({"-e?", "--env=?"}, "set an environment variable", [&](const OptionParser::Value& v)
+    {
+        req.valuebytes += v.size();
+    });
+}
+
+int main()
+{
+    size_t i;
+    size_t before;
+    size_t positional;
+    double secs;
+    Request req;
+    std::chrono::steady_clock::time_point begin;
+    static const size_t requests = 1000000;
+    static const size_t freshrequests = 100000;
+    static const std::vector<std::vector<std::string>> inputs =
+    {
+        {"-v", "--user=builder", "make", "-j8", "all"},
+        {"--timeout=30", "-e", "PATH=/usr/local/bin:/usr/bin:/bin", "/opt/jobs/nightly-backup.sh"},
+        {"-vvn", "rsync", "--", "-a", "/srv/data/", "backup.example.com:/srv/data/"},
+        {"--dry-run", "--env=LANG=C.UTF-8", "--env=TZ=UTC", "cleanup", "--older-than", "30d"},
+        {"status"},
+        {"-u", "www-data", "-t", "5", "/usr/share/webapp/bin/reload-configuration"},
+    };
+    OptionParser prs(false);
+    declare(prs, req);
+    prs.freeze();
+    // one round through all inputs, so every buffer has seen its largest run
+    for(i=0; i<inputs.size(); i++)
+    {
+        prs.reset();
+        prs.parse(inputs[i]);
+    }
+    positional = 0;
+    before = g_allocations;
+    begin = std::chrono::steady_clock::now();
+    for(i=0; i<requests; i++)
+    {
+        prs.reset();
+        prs.parse(inputs[i % inputs.size()]);
+        positional += prs.size();
+    }
+    secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    std::cout << "reused parser: " << requests << " requests in " << secs << "s, " << ((secs * 1e9) / requests) << "ns per request, ";
+    std::cout << (double(g_allocations - before) / requests) << " allocations per request" << std::endl;
+    before = g_allocations;
+    begin = std::chrono::steady_clock::now();
+    for(i=0; i<freshrequests; i++)
+    {
+        OptionParser fresh(false);
+        declare(fresh, req);
+        fresh.parse(inputs[i % inputs.size()]);
+        positional += fresh.size();
+    }
+    secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    std::cout << "new parser per request: " << freshrequests << " requests in " << secs << "s, " << ((secs * 1e9) / freshrequests) << "ns per request, ";
+    std::cout << (double(g_allocations - before) / freshrequests) << " allocations per request" << std::endl;
+    return ((positional > 0) && (req.verbose > 0)) ? 0 : 1;
+}
@@ -0,0 +1,167 @@
+/*
+* parses requests on 1 up to 32 threads at once, like a request router would:
+* all of them against the same frozen parser, each thread with a ParseContext of
+* its own. every result is checked against the one of a single-threaded run, and
+* the throughput is reported for each number of threads - which should scale
+* linearly, up to the number of cores.
+*/
+
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include "optionparser.hpp"
+
+struct Request
+{
+    int verbose = 0;
+    int force = 0;
+    size_t valuebytes = 0;
+};
+
+struct Expected
+{
+    Request req;
+    size_t positional;
+    size_t cmdpositional;
+    std::string command;
+};
+
+// the callbacks are shared by all threads, so each thread collects into its own
+static thread_local Request t_req;
+
+static void declare(OptionParser& prs)
+{
+    prs.on({"-v", "--verbose"}, "be verbose", []
+    {
+        t_req.verbose++;
+    });
+    prs.on({"-u?", "--user=?"}, "run as user", [](const OptionParser::Value& v)
+    {
+        t_req.valuebytes += v.size();
+    });
+    prs.on({"-e?", "--env=?"}, "set an environment variable", [](const OptionParser::Value& v)
+    {
+        t_req.valuebytes += v.size();
+    });
+    prs.onCommand("run", "run a job", [](OptionParser& sub)
+    {
+        sub.on({"-f", "--force"}, "even if it ran already", []
+        {
+            t_req.force++;
+        });
+        sub.on({"-t?", "--timeout=?"}, "give up after this many seconds", [](const OptionParser::Value& v)
+        {
+            t_req.valuebytes += v.size();
+        });
+    });
+}
+
+static const std::vector<std::vector<std::string>> g_inputs =
+{
+    {"-v", "--user=builder", "run", "-f", "--timeout=30", "nightly-backup"},
+    {"--env=PATH=/usr/local/bin:/usr/bin:/bin", "-vv", "status", "all"},
+    {"run", "-vf", "-t", "5", "--env=LANG=C.UTF-8", "reload", "--", "-x"},
+    {"-u", "www-data", "cleanup", "/var/cache/webapp", "/tmp/webapp"},
+    {"run"},
+};
+
+static Expected expect(const OptionParser& prs, OptionParser::ParseContext& ctx, const std::vector<std::string>& args)
+{
+    Expected exp;
+    t_req = Request();
+    prs.parse(ctx, args.begin(), args.end());
+    exp.req = t_req;
+    exp.positional = ctx.size();
+    exp.cmdpositional = ((ctx.command() != nullptr) ? ctx.command()->size() : 0);
+    exp.command = ctx.commandName();
+    return exp;
+}
+
+/*
+* parses $count requests, and returns how many of them did not yield the
+* expected result.
+*/
+static size_t worker(const OptionParser& prs, const std::vector<Expected>& expected, size_t count)
+{
+    size_t i;
+    size_t idx;
+    size_t wrong;
+    OptionParser::ParseContext ctx;
+    wrong = 0;
+    for(i=0; i<count; i++)
+    {
+        idx = (i % g_inputs.size());
+        const Expected& exp = expected[idx];
+        t_req = Request();
+        prs.parse(ctx, g_inputs[idx].begin(), g_inputs[idx].end());
+        if(
+            (t_req.verbose != exp.req.verbose) ||
+            (t_req.force != exp.req.force) ||
+            (t_req.valuebytes != exp.req.valuebytes) ||
+            (ctx.size() != exp.positional) ||
+            (ctx.commandName() != exp.command) ||
+            (((ctx.command() != nullptr) ? ctx.command()->size() : 0) != exp.cmdpositional)
+        )
+        {
+            wrong++;
+        }
+    }
+    return wrong;
+}
+
+int main()
+{
+    size_t i;
+    size_t nthreads;
+    double secs;
+    double base;
+    double rate;
+    std::atomic<size_t> wrong;
+    std::vector<Expected> expected;
+    std::vector<std::thread> threads;
+    std::chrono::steady_clock::time_point begin;
+    static const size_t perthread = 500000;
+    OptionParser prs(false);
+    declare(prs);
+    prs.freeze();
+    {
+        OptionParser::ParseContext ctx;
+        for(i=0; i<g_inputs.size(); i++)
+        {
+            expected.push_back(expect(prs, ctx, g_inputs[i]));
+        }
+    }
+    std::cout << std::thread::hardware_concurrency() << " cores" << std::endl;
+    wrong = 0;
+    base = 0;
+    for(nthreads=1; nthreads<=32; nthreads*=2)
+    {
+        threads.clear();
+        begin = std::chrono::steady_clock::now();
+        for(i=0; i<nthreads; i++)
+        {
+            threads.emplace_back([&]
+            {
+                wrong += worker(prs, expected, perthread);
+            });
+        }
+        for(i=0; i<nthreads; i++)
+        {
+            threads[i].join();
+        }
+        secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        rate = ((nthreads * perthread) / secs);
+        if(nthreads == 1)
+        {
+            base = rate;
+        }
+        std::cout << nthreads << " threads: " << size_t(rate) << " requests per second, " << (rate / base) << "x the rate of 1 thread" << std::endl;
+    }
+    if(wrong > 0)
+    {
+        std::cerr << wrong << " requests had the wrong result" << std::endl;
+        return 1;
+    }
+    return 0;
+}
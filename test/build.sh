@@ -7,12 +7,16 @@ function vexec
 }
 
 # so sue me for being lazy
-CXX="clang++"
+CXX="${CXX:-c++}"
 mkdir -p "./bin"
+# gencheck.cpp includes the parser that optgen generates from gencheck.spec
+vexec "$CXX" -std=c++17 -I.. -g3 -ggdb ../tools/optgen.cpp -o "bin/optgen.exe"
+vexec ./bin/optgen.exe gencheck.spec bin/gencheck_options.hpp gencheck
 for infile in *.cpp; do
   base="$(basename "$infile")"
   nocpp="${base%.*}"
   exename="${nocpp}.exe"
   outfile="bin/$exename"
-  vexec "$CXX" -std=c++17 -I../include -g3 -ggdb "$infile" -o "$outfile"
+  vexec "$CXX" -std=c++17 -I../include -I.. -I./bin -g3 -ggdb "$infile" -o "$outfile"
 done
+vexec ./bin/gencheck.exe
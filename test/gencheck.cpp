@@ -0,0 +1,148 @@
+/*
+* compares the parser generated by tools/optgen from gencheck.spec with the
+* runtime parser, declared from the same spec: for every argument vector, both
+* must end up with the same options and positional values, or fail with the
+* same message.
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include "optionparser.hpp"
+#include "gencheck_options.hpp"
+
+static bool sameoptions(const gencheck::Options& a, const gencheck::Options& b)
+{
+    return (
+        (a.verbose == b.verbose) &&
+        (a.debug == b.debug) &&
+        (a.outfile == b.outfile) &&
+        (a.jobs == b.jobs) &&
+        (a.include == b.include) &&
+        (a.quiet == b.quiet) &&
+        (a.out == b.out) &&
+        (a.target == b.target) &&
+        (a.positional == b.positional)
+    );
+}
+
+static std::string describe(const std::vector<std::string>& args)
+{
+    size_t i;
+    std::stringstream buf;
+    for(i=0; i<args.size(); i++)
+    {
+        buf << " " << std::quoted(args[i]);
+    }
+    return buf.str();
+}
+
+static bool check(const std::vector<std::string>& args)
+{
+    std::string rterr;
+    std::string generr;
+    gencheck::Options rtopts;
+    gencheck::Options genopts;
+    OptionParser prs(false);
+    gencheck::declare(prs, rtopts);
+    try
+    {
+        prs.parse(args);
+        rtopts.positional = prs.positional();
+    }
+    catch(std::exception& ex)
+    {
+        rterr = ex.what();
+    }
+    try
+    {
+        gencheck::parse(genopts, args);
+    }
+    catch(std::exception& ex)
+    {
+        generr = ex.what();
+    }
+    if(rterr != generr)
+    {
+        std::cerr << "error mismatch for" << describe(args) << ": runtime='" << rterr << "', generated='" << generr << "'" << std::endl;
+        return false;
+    }
+    if(rterr.empty() && !sameoptions(rtopts, genopts))
+    {
+        std::cerr << "result mismatch for" << describe(args) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main()
+{
+    size_t i;
+    size_t j;
+    size_t failed;
+    std::vector<std::string> args;
+    std::mt19937 rng(1234);
+    static const std::vector<std::vector<std::string>> fixed =
+    {
+        {},
+        {"-v", "-vv", "--verbose", "--talk", "file.c"},
+        {"-ofoo", "-o", "bar", "--outputfile=baz"},
+        {"-o", "-v"},
+        {"-o"},
+        {"--outputfile"},
+        {"--jobs=12", "-j", "3", "-j7"},
+        {"--jobs=twelve"},
+        {"-Ia", "-A", "b", "--include=c", "--include="},
+        {"-vdq", "-vo", "-dj4"},
+        {"-x"},
+        {"-vx"},
+        {"--nope"},
+        {"--verbose=yes"},
+        {"-"},
+        {"", "a", "--", "-v", "--", "--quiet"},
+        {"-\xc3\xa9", "-v\xc3\xa9", "-v\xc3"},
+        {"--=x"},
+        {"--out=a", "--target=b", "--out=", "--target="},
+        {"--out", "x"},
+        {"--target"},
+    };
+    static const std::vector<std::string> pool =
+    {
+        "-v", "-d", "-q", "-vdq", "-o", "-ofile", "-j", "-j9", "-jx", "-I", "-Ipath", "-A", "-Apath",
+        "--verbose", "--talk", "--debug", "--quiet", "--outputfile=x", "--outputfile", "--jobs=5",
+        "--jobs=", "--include=p", "--inc", "--", "-", "pos", "other", "", "-z", "-vz", "-qo",
+        "-dI/usr", "--verbose=1", "-\xc3\xa9", "--out=o", "--out", "--target=t", "--target",
+    };
+    failed = 0;
+    for(i=0; i<fixed.size(); i++)
+    {
+        failed += !check(fixed[i]);
+    }
+    for(i=0; i<20000; i++)
+    {
+        args.clear();
+        for(j=(rng() % 6); j>0; j--)
+        {
+            args.push_back(pool[rng() % pool.size()]);
+        }
+        failed += !check(args);
+    }
+    // the help text is rendered at generation time, by the same code
+    {
+        gencheck::Options dummy;
+        OptionParser prs(false);
+        gencheck::declare(prs, dummy);
+        if(prs.help() != gencheck::helptext)
+        {
+            std::cerr << "help text mismatch" << std::endl;
+            failed++;
+        }
+    }
+    if(failed > 0)
+    {
+        std::cerr << failed << " mismatches" << std::endl;
+        return 1;
+    }
+    std::cout << "generated parser matches runtime parser" << std::endl;
+    return 0;
+}
@@ -0,0 +1,10 @@
+# options used by gencheck.cpp, which compares the parser generated by
+# tools/optgen from this file with the runtime parser.
+count   verbose   -v --verbose --talk         : increase verbosity
+count   debug     -d --debug                  : toggle debug mode
+string  outfile   -o<file> --outputfile=<file> : set output file
+int     jobs      -j<n> --jobs=<n>            : number of parallel jobs
+list    include   -I<path> -A<path> --include=<path> : add a path to the include searchpath
+count   quiet     -q --quiet -v               : be quiet
+string  out       --out=<file>                : set output file, long name only
+string  target    --target=?                  : set target, long name only
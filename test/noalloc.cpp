@@ -0,0 +1,86 @@
+/*
+* counts heap allocations, and fails unless parsing flags that take no value
+* performs none at all: neither resolving them (short, clustered, long, or
+* through an alias), nor invoking their callbacks.
+* the first run of a ParseContext may grow its vectors, so every case is parsed
+* once before it is counted.
+*/
+
+#include <iostream>
+#include "optionparser.hpp"
+#include "allocount.hpp"
+
+int main()
+{
+    size_t i;
+    size_t before;
+    size_t failed;
+    int flags;
+    std::vector<std::string> store;
+    std::vector<char*> argv;
+    static const std::vector<std::vector<std::string>> inputs =
+    {
+        {"-v"},
+        {"-v", "-d", "-q"},
+        {"-vdq", "-qqq", "-dv"},
+        {"--verbose", "--debug", "--quiet"},
+        {"--talk", "-v", "--verbose", "-vvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvv"},
+    };
+    OptionParser prs(false);
+    flags = 0;
+    prs.on({"-v", "--verbose"}, "be verbose", [&]
+    {
+        flags++;
+    }).alias({"--talk"});
+    prs.on({"-d", "--debug"}, "debug mode", [&]
+    {
+        flags++;
+    });
+    prs.on({"-q", "--quiet"}, "be quiet", [&]
+    {
+        flags++;
+    });
+    prs.on({"-o?", "--out=?"}, "output file", [&](const OptionParser::Value&)
+    {
+    });
+    prs.freeze();
+    failed = 0;
+    for(i=0; i<inputs.size(); i++)
+    {
+        OptionParser::ParseContext ctx;
+        store = inputs[i];
+        argv.clear();
+        argv.push_back(nullptr);
+        for(auto& arg: store)
+        {
+            argv.push_back(arg.data());
+        }
+        // with a ParseContext
+        prs.parse(ctx, int(argv.size()), argv.data());
+        before = g_allocations;
+        prs.parse(ctx, int(argv.size()), argv.data());
+        prs.parse(ctx, store.begin(), store.end());
+        if(g_allocations != before)
+        {
+            std::cerr << "case " << i << ": parse(ParseContext&, ...) performed " << (g_allocations - before) << " allocations" << std::endl;
+            failed++;
+        }
+        // without one, reset() in between
+        prs.reset();
+        prs.parse(int(argv.size()), argv.data());
+        before = g_allocations;
+        prs.reset();
+        prs.parse(int(argv.size()), argv.data());
+        if(g_allocations != before)
+        {
+            std::cerr << "case " << i << ": parse(argc, argv) performed " << (g_allocations - before) << " allocations" << std::endl;
+            failed++;
+        }
+    }
+    if(failed > 0)
+    {
+        return 1;
+    }
+    std::cout << "parsing flags performed no allocations (" << flags << " flags seen)" << std::endl;
+    return 0;
+}
@@ -0,0 +1,896 @@
+/*
+* regression tests: each case parses a few argument vectors, and checks what
+* the callbacks, and help() saw. built with the same flags as everything else
+* (i.e., -O2), since some of these only ever showed up in optimized builds.
+*/
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include "optionparser.hpp"
+
+static size_t g_failures = 0;
+
+static void check(bool cond, const char* what)
+{
+    if(!cond)
+    {
+        std::cerr << "FAILED: " << what << std::endl;
+        g_failures++;
+    }
+}
+
+/*
+* runs $fn, and returns the message of the error it threw, or an empty string.
+*/
+template<typename FuncT>
+static std::string errorof(FuncT fn)
+{
+    try
+    {
+        fn();
+    }
+    catch(std::exception& ex)
+    {
+        return ex.what();
+    }
+    return std::string();
+}
+
+/*
+* options declared with only a long name (GNU or DOS) that take a value.
+*/
+static void test_longonlyvalue()
+{
+    std::string out;
+    std::string dosout;
+    std::string help;
+    OptionParser prs(false);
+    prs.on({"--out=?"}, "output file", [&](const OptionParser::Value& v)
+    {
+        out = v.str();
+    });
+    prs.on({"/dosout:?"}, "dos output file", [&](const OptionParser::Value& v)
+    {
+        dosout = v.str();
+    });
+    prs.parse({"--out=a.txt", "/dosout:b.txt"});
+    check(out == "a.txt", "--out=a.txt passes its value");
+    check(dosout == "b.txt", "/dosout:b.txt passes its value");
+    check(errorof([&]{ prs.parse({"--out"}); }).size() > 0, "--out without a value is an error");
+    help = prs.help();
+    check(help.find("--out=<val>") != std::string::npos, "help shows --out=<val>");
+    check(help.find("/dosout:<val>") != std::string::npos, "help shows /dosout:<val>");
+}
+
+/*
+* aliases of a long-only value option, in GNU and DOS syntax.
+*/
+static void test_aliasvalue()
+{
+    std::string out;
+    OptionParser prs(false);
+    prs.on({"--out=?"}, "output file", [&](const OptionParser::Value& v)
+    {
+        out = v.str();
+    }).alias({"/x:<v>", "--output=<file>"});
+    prs.parse({"/x:a.txt"});
+    check(out == "a.txt", "/x:a.txt passes its value");
+    prs.parse({"--output=b.txt"});
+    check(out == "b.txt", "--output=b.txt passes its value");
+    check(errorof([&]{ prs.parse({"/x"}); }).size() > 0, "/x without a value is an error");
+    check(errorof([&]{ prs.on({"--verbose"}, "verbose", []{}).alias({"/v:<v>"}); }).size() > 0, "a value alias of a flag is rejected");
+}
+
+/*
+* arguments passed as views need not be NUL terminated: "-" viewed out of "-x"
+* is just "-".
+*/
+static void test_unterminatedview()
+{
+    int xcount;
+    std::string msg;
+    std::string_view views[1];
+    OptionParser prs(false);
+    static const char buf[] = {'-', 'x'};
+    xcount = 0;
+    prs.on({"-x"}, "x", [&]
+    {
+        xcount++;
+    });
+    views[0] = std::string_view(buf, 1);
+    msg = errorof([&]{ prs.parse(views, views + 1); });
+    check(msg == "unknown option '-'", "\"-\" viewed out of \"-x\" is an unknown option");
+    check(xcount == 0, "\"-\" viewed out of \"-x\" does not invoke -x");
+}
+
+/*
+* values are views into the arguments; indexing one at its end must not read
+* what follows it.
+*/
+static void test_valueend()
+{
+    int last;
+    std::string_view views[2];
+    OptionParser prs(false);
+    static const char buf[] = {'-', 'o', 'a', 'b', 'c'};
+    last = -1;
+    prs.on({"-o?"}, "o", [&](const OptionParser::Value& v)
+    {
+        last = v[int(v.size())];
+    });
+    views[0] = std::string_view(buf, 2);
+    views[1] = std::string_view(buf + 2, 2);
+    prs.parse(views, views + 2);
+    check(last == 0, "a value is NUL past its end");
+}
+
+/*
+* clones share their declarations, subcommands included, but not the state of
+* the subcommand seen by parse().
+*/
+static void test_clonecommands()
+{
+    int verbose;
+    std::string name;
+    OptionParser a(false);
+    verbose = 0;
+    a.onCommand("commit", "record changes", [&](OptionParser& sub)
+    {
+        sub.on({"--name=?"}, "name", [&](const OptionParser::Value& v)
+        {
+            name = v.str();
+        });
+    });
+    // declared after the command, yet still recognized by it
+    a.on({"/v"}, "verbose", [&]
+    {
+        verbose++;
+    });
+    OptionParser b = a.clone();
+    a.parse({"commit", "A"});
+    b.parse({"commit", "B", "/v", "--name=n"});
+    check((a.command() != nullptr) && (b.command() != nullptr), "both clones saw the command");
+    check(a.command() != b.command(), "clones have subcommand parsers of their own");
+    check((a.command()->size() == 1) && (a.command()->positional(0) == "A"), "the command of a only saw A");
+    check((b.command()->size() == 1) && (b.command()->positional(0) == "B"), "the command of b only saw B");
+    check((verbose == 1) && (name == "n"), "/v and --name=n were parsed by the command of b");
+    a.reset();
+    check((a.command() == nullptr) && (b.command()->size() == 1), "reset() of a leaves b alone");
+}
+
+/*
+* neither form of a negatable option takes a value - "--no-color=yes" must not
+* quietly turn color off.
+*/
+static void test_negatablevalue()
+{
+    int calls;
+    OptionParser prs(false);
+    calls = 0;
+    prs.allowSingleDashLong();
+    prs.onNegatable({"-c", "--color"}, "colorize output", [&](bool)
+    {
+        calls++;
+    });
+    check(errorof([&]{ prs.parse({"--no-color=yes"}); }) == "option 'no-color' does not take a value", "--no-color=yes is rejected");
+    check(errorof([&]{ prs.parse({"--color=no"}); }) == "option 'color' does not take a value", "--color=no is rejected");
+    check(errorof([&]{ prs.parse({"-no-color=yes"}); }) == "option '-no-color' does not take a value", "-no-color=yes is rejected");
+    check(calls == 0, "rejected values invoke nothing");
+    prs.parse({"--no-color", "--color", "-c", "-no-color"});
+    check(calls == 4, "negatable options without a value still work");
+}
+
+/*
+* on({}, ...) declares nothing that could be parsed, and shows up nowhere in help().
+*/
+static void test_emptydeclaration()
+{
+    std::string help;
+    OptionParser prs(false);
+    prs.on({"-a"}, "a", []{});
+    prs.on({}, "nothing", []{});
+    help = prs.help();
+    check(help.find("[-a] <args ...>") != std::string::npos, "the usage line has no empty entry");
+    check(help.find("nothing") == std::string::npos, "the description of on({}) is not shown");
+    prs.on({}, "nothing", []{});
+    prs.on({"-b"}, "b", []{});
+    check(prs.help().find("[-a] [-b] <args ...>") != std::string::npos, "empty entries between others leave no gap");
+}
+
+static constexpr OptionParser::StaticOption g_staticopts[] =
+{
+    {{"--out=?"}, "output file, long name only"},
+    {{"-o?"}, "output file, short name only"},
+};
+
+/*
+* a declaration needs a value if any of its names asks for one; the runtime
+* grammar and the compile-time grammar agree on this.
+*/
+static void test_needvaluerule()
+{
+    std::string out;
+    OptionParser prs(false);
+    StaticOptionParser<g_staticopts> sprs(false);
+    check(prs.on({"--out=?"}, "long only", [](const OptionParser::Value&){}).needvalue(), "--out=? needs a value");
+    check(prs.on({"-o?"}, "short only", [](const OptionParser::Value&){}).needvalue(), "-o? needs a value");
+    check(prs.on({"-i?", "--in=?"}, "both", [](const OptionParser::Value&){}).needvalue(), "-i? --in=? needs a value");
+    check(!prs.on({"-v", "--verbose"}, "neither", []{}).needvalue(), "-v --verbose needs no value");
+    check(errorof([&]{ prs.on({"-x", "--ex=?"}, "mismatch", []{}); }).size() > 0, "-x --ex=? is rejected");
+    check(errorof([&]{ prs.on({"-y?", "--why"}, "mismatch", []{}); }).size() > 0, "-y? --why is rejected");
+    sprs.bind(0, [&](const OptionParser::Value& v)
+    {
+        out = v.str();
+    });
+    sprs.bind(1, [&](const OptionParser::Value& v)
+    {
+        out = v.str();
+    });
+    sprs.parse({"--out=static"});
+    check(out == "static", "static --out=? passes its value");
+    sprs.parse({"-o", "short"});
+    check(out == "short", "static -o? takes the next argument");
+    check(errorof([&]{ sprs.parse({"--out"}); }).size() > 0, "static --out without a value is an error");
+}
+
+/*
+* clones, and parsers returned by load(), can be moved into containers; options
+* of a loaded parser that were never bound are an error, not a crash.
+*/
+static void test_moveandload()
+{
+    size_t i;
+    int verbose;
+    std::string out;
+    std::vector<OptionParser> parsers;
+    std::string path = "bin/regress.schema";
+    OptionParser prs(false);
+    verbose = 0;
+    prs.on({"-v", "--verbose"}, "be verbose", [&]
+    {
+        verbose++;
+    });
+    prs.on({"-o?", "--out=?"}, "output file", [&](const OptionParser::Value& v)
+    {
+        out = v.str();
+    });
+    for(i=0; i<4; i++)
+    {
+        parsers.push_back(prs.clone());
+    }
+    for(i=0; i<parsers.size(); i++)
+    {
+        parsers[i].parse({"-v", "pos"});
+        check(parsers[i].size() == 1, "a moved clone keeps its positional values");
+    }
+    check(verbose == 4, "moved clones invoke the callbacks");
+    OptionParser moved(std::move(prs));
+    OptionParser::Declaration& decl = moved.on({"-q"}, "be quiet", [&]
+    {
+        verbose = 0;
+    });
+    OptionParser target(std::move(moved));
+    decl.alias({"--quiet"});
+    target.parse({"--quiet"});
+    check(verbose == 0, "alias() after a move reaches the new parser");
+    target.freeze();
+    target.save(path);
+    parsers.push_back(OptionParser::load(path));
+    check(errorof([&]{ parsers.back().parse({"-v"}); }) == "option has no callback; bind() one first", "an unbound loaded option is an error");
+    parsers.back().bind(1, [&](const OptionParser::Value& v)
+    {
+        out = v.str();
+    });
+    parsers.back().parse({"--out=loaded"});
+    check(out == "loaded", "a bound loaded option works after a move");
+}
+
+/*
+* factories of subcommands run when their command is first seen - not when
+* declared, cloned, or when a clone declares something of its own.
+*/
+static void test_lazycommands()
+{
+    size_t i;
+    int calls;
+    OptionParser prs(false);
+    calls = 0;
+    for(i=0; i<80; i++)
+    {
+        prs.onCommand("cmd" + std::to_string(i), "a command", [&](OptionParser& sub)
+        {
+            calls++;
+            sub.on({"-f"}, "force", []{});
+        });
+    }
+    check(calls == 0, "onCommand() runs no factory");
+    OptionParser other = prs.clone();
+    other.on({"-v"}, "verbose", []{});
+    check(calls == 0, "declaring on a clone runs no factory");
+    prs.parse({"cmd5", "-f"});
+    prs.parse({"cmd5"});
+    check(calls == 1, "a command seen twice runs its factory once");
+    other.parse({"cmd5", "-f", "-v"});
+    check(calls == 2, "a clone with a schema of its own runs the factory again, once seen");
+    other.freeze();
+    check(calls == 81, "freeze() runs the factories of the commands not seen yet");
+}
+
+/*
+* declares a bit of everything that ends up in a schema file, and saves it.
+*/
+static std::string savedschema()
+{
+    std::ostringstream out;
+    OptionParser prs(false);
+    prs.allowAbbreviations();
+    prs.on({"-v", "--verbose"}, "be verbose", []{});
+    prs.on({"--version"}, "print the version", []{});
+    prs.on({"-o?", "--out=?"}, "output file", [](const OptionParser::Value&){});
+    prs.on({"/dos:?"}, "dos option", [](const OptionParser::Value&){});
+    prs.on({"-W*"}, "warnings", [](const OptionParser::Value&){});
+    prs.onNumber({"-O"}, "optimization level", [](long long){});
+    prs.freeze();
+    prs.save(out);
+    return out.str();
+}
+
+/*
+* saving the same schema twice gives the same bytes, whatever the heap held
+* before; padding must never reach the file.
+*/
+static void test_savedeterministic()
+{
+    size_t i;
+    std::string first;
+    std::vector<std::string> garbage;
+    first = savedschema();
+    for(i=0; i<1000; i++)
+    {
+        garbage.push_back(std::string(64 + (i % 64), char(0xA5 + i)));
+    }
+    garbage.clear();
+    check(savedschema() == first, "two saves of the same schema are identical");
+}
+
+/*
+* a schema file whose abbreviation trie links a node back to an earlier sibling
+* is refused by load(), rather than sending lookups into an endless loop.
+*/
+static void test_corrupttrie()
+{
+    size_t i;
+    size_t pos;
+    size_t count;
+    uint32_t link;
+    uint32_t back;
+    std::string bytes;
+    std::string path = "bin/corrupt.schema";
+    // the root node, past its first child: no sibling, no declarations, no code unit, no flags
+    static const uint32_t root[5] = {0, 0xFFFFFFFF, 0xFFFFFFFF, 0, 0};
+    // see PrefixTrie::Node
+    static const size_t nodesize = 24;
+    bytes = savedschema();
+    // the root of the abbreviation trie is the first one with children
+    for(pos=0; (pos + nodesize) <= bytes.size(); pos+=8)
+    {
+        if((std::memcmp(bytes.data() + pos + 4, root, sizeof(root)) == 0) && (bytes[pos] != 0))
+        {
+            break;
+        }
+    }
+    if((pos + nodesize) > bytes.size())
+    {
+        check(false, "found the abbreviation trie");
+        return;
+    }
+    std::memcpy(&count, bytes.data() + pos - 8, sizeof(count));
+    for(i=1; i<count; i++)
+    {
+        std::memcpy(&link, bytes.data() + pos + (i * nodesize) + 4, sizeof(link));
+        if((link != 0) && (link < count))
+        {
+            // the next sibling of node $i now links back to it
+            back = uint32_t(i);
+            std::memcpy(&bytes[pos + (link * nodesize) + 4], &back, sizeof(back));
+            break;
+        }
+    }
+    check(i < count, "found a node with a sibling");
+    std::ofstream(path, std::ios::binary) << bytes;
+    check(errorof([&]{ OptionParser::load(path); }) == "schema file is truncated or corrupt", "a trie with a cycle is refused");
+}
+
+/*
+* abbreviated long options: unique prefixes resolve, ambiguous ones list the
+* candidates, and exact matches win - no matter when abbreviations were allowed.
+*/
+static void test_abbreviations()
+{
+    int verbose;
+    int version;
+    int bar;
+    int verb;
+    OptionParser prs(false);
+    verbose = 0;
+    version = 0;
+    bar = 0;
+    verb = 0;
+    prs.allowAbbreviations();
+    prs.on({"--verbose"}, "be verbose", [&]
+    {
+        verbose++;
+    });
+    prs.on({"--version"}, "print the version", [&]
+    {
+        version++;
+    });
+    prs.parse({"--verb", "--vers"});
+    check((verbose == 1) && (version == 1), "unique prefixes resolve to their option");
+    check(errorof([&]{ prs.parse({"--ver"}); }) == "option '--ver' is ambiguous; possibilities: '--verbose' '--version'", "an ambiguous prefix lists the candidates");
+    prs.on({"--verb"}, "an option that is a prefix of another", [&]
+    {
+        verb++;
+    });
+    prs.parse({"--verb"});
+    check((verb == 1) && (verbose == 1), "an exact match wins over an abbreviation");
+    // declared while abbreviations are disabled
+    prs.allowAbbreviations(false);
+    prs.on({"--bar"}, "bar", [&]
+    {
+        bar++;
+    });
+    check(errorof([&]{ prs.parse({"--ba"}); }) == "unknown option 'ba'", "no abbreviations while disabled");
+    prs.allowAbbreviations();
+    prs.parse({"--ba"});
+    check(bar == 1, "names declared while disabled resolve once enabled again");
+}
+
+/*
+* prefix families: the longest prefix wins, declared options come first for
+* "--*", and "-*" is no family at all.
+*/
+static void test_families()
+{
+    std::string warn;
+    std::string wno;
+    std::string rest;
+    int verbose;
+    OptionParser prs(false);
+    verbose = 0;
+    prs.on({"-v", "--verbose"}, "be verbose", [&]
+    {
+        verbose++;
+    });
+    prs.on({"-W*"}, "warnings", [&](const OptionParser::Value& v)
+    {
+        warn = v.str();
+    });
+    prs.on({"-Wno-*"}, "disabled warnings", [&](const OptionParser::Value& v)
+    {
+        wno = v.str();
+    });
+    prs.on({"--*"}, "any other long option", [&](const OptionParser::Value& v)
+    {
+        rest = v.str();
+    });
+    prs.parse({"-Wall", "-Wno-unused", "--verbose", "--whatever=1"});
+    check(warn == "all", "-Wall passes \"all\" to -W*");
+    check(wno == "unused", "-Wno-unused goes to the longer prefix -Wno-*");
+    check((verbose == 1) && (rest == "whatever=1"), "--* only takes long options that are not declared");
+    check(errorof([&]{ prs.parse({"-W"}); }).size() > 0, "the bare prefix is not a member of the family");
+    check(errorof([&]{ prs.on({"-*"}, "everything", [](const OptionParser::Value&){}); }) == "unparseable option syntax '-*'", "-* is rejected");
+}
+
+/*
+* the callbacks a run invoked, in order, followed by its positional values, and
+* those of its subcommand.
+*/
+static std::string g_trace;
+
+static std::string runresult(const OptionParser::ParseContext& ctx)
+{
+    size_t i;
+    std::string res;
+    res = g_trace + "|";
+    for(i=0; i<ctx.size(); i++)
+    {
+        res += std::string(ctx.positional(i)) + " ";
+    }
+    if(ctx.command() != nullptr)
+    {
+        res += "|" + ctx.commandName() + ":";
+        for(i=0; i<ctx.command()->size(); i++)
+        {
+            res += std::string(ctx.command()->positional(i)) + " ";
+        }
+    }
+    return res;
+}
+
+/*
+* feeding the arguments of a run one at a time, and then calling finish(), gives
+* the same result as parse() - or the same error. at every point in between, the
+* callbacks invoked so far are exactly those of the arguments that are complete.
+*/
+static void test_feedsplits()
+{
+    size_t i;
+    size_t split;
+    size_t failed;
+    std::string expected;
+    std::string error;
+    std::string fedtrace;
+    OptionParser prs(false);
+    OptionParser::ParseContext ctx;
+    OptionParser::ParseContext fedctx;
+    static const std::vector<std::vector<std::string>> inputs =
+    {
+        {"-v", "-o", "a.txt", "pos", "-vv"},
+        {"-vo", "b.txt", "--out=c.txt", "-od.txt", "--", "-v"},
+        {"-o", "-v", "-Wall", "-O2", "--no-color", "x"},
+        {"-out", "e.txt", "-verbose", "-out=f.txt"},
+        {"run", "-f", "-t", "5", "-v", "job", "-t"},
+        {"-v", "run", "-t"},
+        {"-v", "-o"},
+        {"-x", "-v"},
+        {"-v", "--color=yes"},
+        {},
+    };
+    prs.allowSingleDashLong();
+    prs.on({"-v", "--verbose"}, "be verbose", []
+    {
+        g_trace += "v ";
+    });
+    prs.on({"-o?", "--out=?"}, "output file", [](const OptionParser::Value& v)
+    {
+        g_trace += "o=" + v.str() + " ";
+    });
+    prs.on({"-W*"}, "warnings", [](const OptionParser::Value& v)
+    {
+        g_trace += "W=" + v.str() + " ";
+    });
+    prs.onNumber({"-O"}, "optimization level", [](long long n)
+    {
+        g_trace += "O=" + std::to_string(n) + " ";
+    });
+    prs.onNegatable({"--color"}, "colorize output", [](bool on)
+    {
+        g_trace += (on ? "color " : "nocolor ");
+    });
+    prs.onCommand("run", "run a job", [](OptionParser& sub)
+    {
+        sub.on({"-f", "--force"}, "even if it ran already", []
+        {
+            g_trace += "f ";
+        });
+        sub.on({"-t?", "--timeout=?"}, "timeout", [](const OptionParser::Value& v)
+        {
+            g_trace += "t=" + v.str() + " ";
+        });
+    });
+    failed = 0;
+    for(i=0; i<inputs.size(); i++)
+    {
+        const std::vector<std::string>& args = inputs[i];
+        g_trace.clear();
+        error = errorof([&]{ prs.parse(ctx, args.begin(), args.end()); });
+        expected = (error.empty() ? runresult(ctx) : ("error: " + error));
+        for(split=0; split<=args.size(); split++)
+        {
+            g_trace.clear();
+            error = errorof([&]
+            {
+                size_t j;
+                for(j=0; j<split; j++)
+                {
+                    prs.feed(fedctx, args[j]);
+                }
+                fedtrace = g_trace;
+                for(j=split; j<args.size(); j++)
+                {
+                    prs.feed(fedctx, args[j]);
+                }
+                prs.finish(fedctx);
+            });
+            if((error.empty() ? runresult(fedctx) : ("error: " + error)) != expected)
+            {
+                std::cerr << "input " << i << ", split at " << split << ": feed() and finish() disagree with parse()" << std::endl;
+                failed++;
+            }
+            // nothing is invoked ahead of its argument, nor held back past a complete one
+            if(error.empty() && (g_trace.compare(0, fedtrace.size(), fedtrace) != 0))
+            {
+                std::cerr << "input " << i << ", split at " << split << ": callbacks ran ahead of their arguments" << std::endl;
+                failed++;
+            }
+        }
+    }
+    check(failed == 0, "feed() and finish() match parse() at every split");
+    // a value that only comes with a later feed() (see waitfornext())
+    g_trace.clear();
+    prs.feed(fedctx, "-o");
+    check(g_trace.empty(), "-o waits for its value");
+    prs.feed(fedctx, "g.txt");
+    check(g_trace == "o=g.txt ", "the next feed() completes -o");
+    prs.feed(fedctx, "run");
+    check(errorof([&]{ prs.feed(fedctx, "-t"); prs.feed(fedctx, "9"); }).empty() && (g_trace == "o=g.txt t=9 "), "a subcommand option waits for its value as well");
+    check(errorof([&]{ prs.finish(fedctx); }).empty(), "finish() after a complete run");
+}
+
+/*
+* numeric families: the number is decoded up to the largest long long, anything
+* beyond raises an error, and anything that is not all digits is parsed as usual.
+*/
+static void test_numeric()
+{
+    long long level;
+    long long bare;
+    OptionParser prs(false);
+    level = -1;
+    bare = -1;
+    prs.onNumber({"-O"}, "optimization level", [&](long long n)
+    {
+        level = n;
+    });
+    prs.onNumber({"-"}, "compression level", [&](long long n)
+    {
+        bare = n;
+    });
+    prs.parse({"-O3", "-15"});
+    check((level == 3) && (bare == 15), "-O3 and -15 are decoded");
+    prs.parse({"-O9223372036854775807"});
+    check(level == std::numeric_limits<long long>::max(), "the largest long long is accepted");
+    check(errorof([&]{ prs.parse({"-O9223372036854775808"}); }) == "numeric option '-O9223372036854775808' is out of range", "one more is out of range");
+    check(errorof([&]{ prs.parse({"-99999999999999999999"}); }) == "numeric option '-99999999999999999999' is out of range", "so is a long bare number");
+    check(errorof([&]{ prs.parse({"-Ofast"}); }) == "unknown short option '-O'", "-Ofast is parsed as short options");
+    check(errorof([&]{ prs.parse({"-O"}); }) == "unknown option '-O'", "the bare prefix is no number");
+    check(errorof([&]{ prs.onNumber({"-Ox"}, "x", [](long long){}); }) == "invalid numeric family prefix '-Ox'", "a prefix is a single character");
+    check(errorof([&]{ prs.onNumber({"--O"}, "x", [](long long){}); }) == "invalid numeric family prefix '--O'", "long prefixes are rejected");
+}
+
+/*
+* LLVM style single-dash long options: the whole word is tried as long option
+* first, then up to "=", and only then as short options.
+*/
+static void test_singledashlong()
+{
+    std::string seen;
+    OptionParser prs(false);
+    prs.allowSingleDashLong();
+    prs.on({"-o?"}, "o", [&](const OptionParser::Value& v)
+    {
+        seen += "o=" + v.str() + " ";
+    });
+    prs.on({"-u"}, "u", [&]
+    {
+        seen += "u ";
+    });
+    prs.on({"--out=?"}, "out", [&](const OptionParser::Value& v)
+    {
+        seen += "out=" + v.str() + " ";
+    });
+    prs.on({"--output=?"}, "output", [&](const OptionParser::Value& v)
+    {
+        seen += "output=" + v.str() + " ";
+    });
+    prs.parse({"-output=a", "-out=b", "-out", "c"});
+    check(seen == "output=a out=b out=c ", "the longest name wins, with its value after \"=\" or as next argument");
+    seen.clear();
+    prs.parse({"-outx", "-ou", "-u"});
+    check(seen == "o=utx o=u u ", "words that are no long option are short options");
+    seen.clear();
+    prs.allowSingleDashLong(false);
+    prs.parse({"-out"});
+    check(seen == "o=ut ", "disabled, -out is -o with a value");
+}
+
+/*
+* every form of a negatable option, declared and bound after load().
+*/
+static void test_negatableforms()
+{
+    std::string seen;
+    std::string path = "bin/negatable.schema";
+    OptionParser prs(false);
+    prs.allowSingleDashLong();
+    prs.onNegatable({"-c", "--color"}, "colorize output", [&](bool on)
+    {
+        seen += (on ? "on " : "off ");
+    });
+    prs.parse({"-c", "--color", "--no-color", "-no-color", "-color"});
+    check(seen == "on on off off on ", "short, long, negated and single-dash forms");
+    check(errorof([&]{ prs.parse({"--no-c"}); }) == "unknown option 'no-c'", "short names have no negated form");
+    prs.freeze();
+    prs.save(path);
+    OptionParser loaded = OptionParser::load(path);
+    seen.clear();
+    loaded.bindNegatable(0, [&](bool on)
+    {
+        seen += (on ? "on " : "off ");
+    });
+    loaded.parse({"--no-color", "-c"});
+    check(seen == "off on ", "bindNegatable() on a loaded parser");
+}
+
+/*
+* DOS style options: case-insensitive names, values after ":", and undeclared
+* words after "/" left alone, since they are paths.
+*/
+static void test_dosoptions()
+{
+    std::string seen;
+    OptionParser prs(false);
+    prs.on({"/v", "/verbose"}, "be verbose", [&]
+    {
+        seen += "v ";
+    });
+    prs.on({"/out:?"}, "output file", [&](const OptionParser::Value& v)
+    {
+        seen += "out=" + v.str() + " ";
+    });
+    prs.parse({"/v", "/VERBOSE", "/out:x.txt", "/OUT:C:\\y.txt", "/usr/bin"});
+    check(seen == "v v out=x.txt out=C:\\y.txt ", "names are case-insensitive, values follow the first \":\"");
+    check((prs.size() == 1) && (prs.positional(0) == "/usr/bin"), "an undeclared /word is a positional value");
+    check(errorof([&]{ prs.parse({"/out"}); }) == "option '/out' expected a value", "/out without a value is an error");
+}
+
+/*
+* short options whose name is a multi-byte utf-8 character, alone and in
+* clusters.
+*/
+static void test_utf8short()
+{
+    std::string seen;
+    OptionParser prs(false);
+    prs.on({"-\xc3\xa4"}, "a umlaut", [&]
+    {
+        seen += "ae ";
+    });
+    prs.on({"-v"}, "verbose", [&]
+    {
+        seen += "v ";
+    });
+    prs.on({"-\xc3\xb6?"}, "o umlaut", [&](const OptionParser::Value& v)
+    {
+        seen += "oe=" + v.str() + " ";
+    });
+    prs.parse({"-v\xc3\xa4v", "-\xc3\xb6wert"});
+    check(seen == "v ae v oe=wert ", "utf-8 short options cluster, and take an attached value");
+    check(errorof([&]{ prs.parse({"-\xc3\xbc"}); }) == "unknown option '-\xc3\xbc'", "an undeclared utf-8 short option is unknown");
+    check(errorof([&]{ prs.parse({"-v\xc3\xa4v\xc3\xb6x"}); }) == "unexpected option '-\xc3\xb6' requiring a value", "a valued utf-8 option inside a cluster is an error");
+    check(errorof([&]{ prs.parse({"-\xc3"}); }).size() > 0, "a truncated utf-8 sequence is not a declared option");
+}
+
+/*
+* freeze(): declarations are rejected afterwards, parsing still works, and a
+* clone may declare again.
+*/
+static void test_freeze()
+{
+    int verbose;
+    std::string help;
+    const std::string frozenmsg = "parser is frozen; its declarations can no longer be changed";
+    OptionParser prs(false);
+    verbose = 0;
+    prs.on({"-v", "--verbose"}, "be verbose", [&]
+    {
+        verbose++;
+    });
+    prs.freeze();
+    help = prs.help();
+    check(prs.frozen(), "frozen() is true after freeze()");
+    check(errorof([&]{ prs.on({"-x"}, "x", []{}); }) == frozenmsg, "on() after freeze() throws");
+    check(errorof([&]{ prs.allowAbbreviations(true); }) == frozenmsg, "allowAbbreviations() after freeze() throws");
+    prs.parse({"-v", "--verbose"});
+    check(verbose == 2, "a frozen parser still parses");
+    prs.freeze();
+    check(prs.help() == help, "freezing again changes nothing");
+    OptionParser copy = prs.clone();
+    check(!copy.frozen(), "a clone of a frozen parser is not frozen");
+    copy.on({"-x"}, "x", []{});
+    check(copy.help().find("-x") != std::string::npos, "a clone of a frozen parser may declare");
+    check(prs.help().find("-x") == std::string::npos, "declaring on the clone leaves the original alone");
+}
+
+/*
+* parse() of ranges borrows the strings of the range, parse() of an rvalue vector
+* takes them over, and parse() of a const vector copies them.
+*/
+static void test_ranges()
+{
+    OptionParser prs(false);
+    OptionParser::ParseContext ctx;
+    const std::string longpos = "a positional value too long for the small string buffer";
+    std::vector<std::string> strs = {"-v", longpos};
+    const char* ptrs[] = {"-v", "ptr"};
+    std::string_view views[] = {"-v", "view"};
+    const char* data;
+    prs.on({"-v"}, "verbose", []{});
+    prs.parse(ctx, strs.begin(), strs.end());
+    check((ctx.size() == 1) && (ctx.positional(0).data() == strs[1].data()), "a range of strings is borrowed, not copied");
+    prs.parse(ctx, std::begin(ptrs), std::end(ptrs));
+    check((ctx.size() == 1) && (ctx.positional(0) == "ptr"), "a range of const char* is parsed");
+    prs.parse(ctx, std::begin(views), std::end(views));
+    check((ctx.size() == 1) && (ctx.positional(0) == "view"), "a range of string_view is parsed");
+    prs.parse(ctx, static_cast<const std::vector<std::string>&>(strs));
+    check((ctx.size() == 1) && (ctx.positional(0) == longpos) && (ctx.positional(0).data() != strs[1].data()), "a const vector is copied");
+    data = strs[1].data();
+    prs.parse(ctx, std::move(strs));
+    check((ctx.size() == 1) && (ctx.positional(0).data() == data), "an rvalue vector is taken over without copying its strings");
+}
+
+static constexpr OptionParser::StaticOption g_statichelpopts[] =
+{
+    {{"-v", "--verbose"}, "be verbose"},
+    {{"-h"}, "own -h"},
+};
+
+/*
+* the help option of a static parser is compiled into its schema, minus the
+* names the array declares itself; without help, those names are free for on().
+*/
+static void test_statichelp()
+{
+    std::string seen;
+    std::string help;
+    StaticOptionParser<g_statichelpopts> sprs;
+    StaticOptionParser<g_statichelpopts> nohelp(false);
+    sprs.bind(0, [&]
+    {
+        seen += "v ";
+    });
+    sprs.bind(1, [&]
+    {
+        seen += "h ";
+    });
+    sprs.parse({"-h", "--verbose"});
+    check(seen == "h v ", "a static -h overrides the one of the help option");
+    help = sprs.help();
+    check(help.find("--help") != std::string::npos, "the help option is shown in help()");
+    check(help.find("show this help") < help.find("be verbose"), "the help option comes first");
+    nohelp.on({"--help"}, "own --help", [&]
+    {
+        seen += "help ";
+    });
+    nohelp.parse({"--help"});
+    check(seen == "h v help ", "without help, --help can be declared with on()");
+    check(nohelp.help().find("show this help") == std::string::npos, "without help, there is no help option");
+    check(errorof([&]{ nohelp.bind(2, []{}); }) == "static option index out of range", "bind() past the array throws");
+}
+
+int main()
+{
+    test_longonlyvalue();
+    test_aliasvalue();
+    test_unterminatedview();
+    test_valueend();
+    test_clonecommands();
+    test_negatablevalue();
+    test_emptydeclaration();
+    test_needvaluerule();
+    test_moveandload();
+    test_lazycommands();
+    test_savedeterministic();
+    test_corrupttrie();
+    test_abbreviations();
+    test_families();
+    test_feedsplits();
+    test_numeric();
+    test_singledashlong();
+    test_negatableforms();
+    test_dosoptions();
+    test_utf8short();
+    test_freeze();
+    test_ranges();
+    test_statichelp();
+    if(g_failures > 0)
+    {
+        std::cerr << g_failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "all regression tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,591 @@
+/*
+* optgen: generates a specialized, dependency-free option parser from a spec file.
+* think gperf, but for options.
+*
+* the spec file declares one option per line:
+*
+*   # comments, and empty lines are ignored
+*   <type> <member> <pattern> [<pattern> ...] : <description>
+*
+* where <type> is one of
+*
+*   count   no value; the member (an int) counts how often the option was seen
+*   string  takes a value; the member holds the last one
+*   int     takes a value, converted to long long; the member holds the last one
+*   list    takes a value; the member (a vector of strings) collects all of them
+*
+* and <pattern> is anything on() accepts for short ("-v", "-o<file>") and GNU long
+* options ("--verbose", "--out=<file>"). patterns are parsed by OptionParser itself, so
+* the grammar - and the resulting help text - is exactly the same as at runtime.
+*
+* the generated header contains, in the given namespace:
+*
+*   - struct Options, with one typed member per option, plus the positional values
+*   - helptext, the constant help text, as help() would render it
+*   - a perfect hash for long names, and a switch for short names
+*   - parse(), which parses into an Options, just like BasicOptionParser::parse() would
+*   - declare(), which declares the very same options on a runtime parser
+*
+* usage: optgen <specfile> <output.hpp> [<namespace>]
+*/
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../optionparser.hpp"
+
+enum class OptType
+{
+    COUNT,
+    STRING,
+    INT,
+    LIST,
+};
+
+struct SpecOption
+{
+    OptType type;
+    std::string member;
+    std::string description;
+    std::vector<std::string> patterns;
+
+    // line of the spec file
+    size_t lineno;
+
+    // filled in from the declaration
+    bool needvalue = false;
+    std::vector<char> shorts;
+    std::vector<std::string> longs;
+};
+
+struct LongEntry
+{
+    std::string name;
+    size_t option;
+};
+
+// must be identical to the hash emitted by writeHeader().
+static uint64_t hashname(const std::string& name, uint64_t seed)
+{
+    size_t i;
+    uint64_t h;
+    h = (14695981039346656037ull ^ seed);
+    for(i=0; i<name.size(); i++)
+    {
+        h ^= uint64_t((unsigned char)(name[i]));
+        h *= 1099511628211ull;
+    }
+    return (h ^ (h >> 29));
+}
+
+static void fail(const std::string& path, size_t lineno, const std::string& msg)
+{
+    std::stringstream buf;
+    buf << path << ":" << lineno << ": " << msg;
+    throw std::runtime_error(buf.str());
+}
+
+static bool isident(const std::string& str)
+{
+    size_t i;
+    if(str.empty() || std::isdigit((unsigned char)(str[0])))
+    {
+        return false;
+    }
+    for(i=0; i<str.size(); i++)
+    {
+        if(!std::isalnum((unsigned char)(str[i])) && (str[i] != '_'))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static std::vector<SpecOption> readSpec(const std::string& path)
+{
+    size_t lineno;
+    std::string line;
+    std::string word;
+    std::vector<SpecOption> opts;
+    std::ifstream in(path);
+    if(!in.good())
+    {
+        throw std::runtime_error("cannot open '" + path + "'");
+    }
+    lineno = 0;
+    while(std::getline(in, line))
+    {
+        SpecOption opt;
+        std::stringstream words(line);
+        lineno++;
+        if(!(words >> word) || (word[0] == '#'))
+        {
+            continue;
+        }
+        if(word == "count")
+        {
+            opt.type = OptType::COUNT;
+        }
+        else if(word == "string")
+        {
+            opt.type = OptType::STRING;
+        }
+        else if(word == "int")
+        {
+            opt.type = OptType::INT;
+        }
+        else if(word == "list")
+        {
+            opt.type = OptType::LIST;
+        }
+        else
+        {
+            fail(path, lineno, "unknown type '" + word + "'");
+        }
+        if(!(words >> opt.member) || !isident(opt.member) || (opt.member == "positional"))
+        {
+            fail(path, lineno, "expected a member name");
+        }
+        while((words >> word) && (word != ":"))
+        {
+            opt.patterns.push_back(word);
+        }
+        if(word != ":")
+        {
+            fail(path, lineno, "expected ':' before the description");
+        }
+        std::getline(words >> std::ws, opt.description);
+        if(opt.patterns.empty())
+        {
+            fail(path, lineno, "no patterns given");
+        }
+        opt.lineno = lineno;
+        opts.push_back(opt);
+    }
+    return opts;
+}
+
+/*
+* declares every option on $prs, and collects its names from the declaration.
+* names declared twice are skipped, since the first declaration wins at runtime too.
+*/
+static void declareSpec(const std::string& path, OptionParser& prs, std::vector<SpecOption>& opts)
+{
+    size_t i;
+    uint32_t n;
+    std::vector<bool> seenshort(128, false);
+    std::vector<std::string> seenlong;
+    for(i=0; i<opts.size(); i++)
+    {
+        SpecOption& opt = opts[i];
+        OptionParser::Declaration& decl = prs.on(opt.patterns, opt.description, []{});
+        opt.needvalue = decl.needvalue();
+        if(opt.needvalue != (opt.type != OptType::COUNT))
+        {
+            fail(path, opt.lineno, "option '" + opt.member + "': only 'count' options may be declared without a value");
+        }
+        for(n=decl.firstname; n!=OptionParser::npos; n=decl.schema->names[n].next)
+        {
+            const OptionParser::NameRef& ref = decl.schema->names[n];
+            std::string name = decl.schema->name_str(ref);
+            if(ref.kind == OptionParser::NameRef::SHORT)
+            {
+                if((name.size() != 1) || ((unsigned char)(name[0]) >= 0x80))
+                {
+                    fail(path, opt.lineno, "short option '-" + name + "': only ASCII is supported");
+                }
+                if(!seenshort[(unsigned char)(name[0])])
+                {
+                    seenshort[(unsigned char)(name[0])] = true;
+                    opt.shorts.push_back(name[0]);
+                }
+            }
+            else if(ref.kind == OptionParser::NameRef::GNU)
+            {
+                if(std::find(seenlong.begin(), seenlong.end(), name) == seenlong.end())
+                {
+                    seenlong.push_back(name);
+                    opt.longs.push_back(name);
+                }
+            }
+            else
+            {
+                fail(path, opt.lineno, "option '" + opt.member + "': only short and GNU long options are supported");
+            }
+        }
+    }
+    prs.freeze();
+}
+
+/*
+* finds a seed for which every long name lands in a slot of its own.
+* the table is doubled until one is found.
+*/
+static std::vector<long> perfectHash(const std::vector<LongEntry>& longs, uint64_t& seed)
+{
+    size_t i;
+    size_t size;
+    uint64_t pos;
+    bool ok;
+    std::vector<long> table;
+    size = 1;
+    while(size < longs.size())
+    {
+        size *= 2;
+    }
+    while(true)
+    {
+        for(seed=0; seed<20000; seed++)
+        {
+            ok = true;
+            table.assign(size, -1);
+            for(i=0; (i<longs.size()) && ok; i++)
+            {
+                pos = (hashname(longs[i].name, seed) & (size - 1));
+                ok = (table[pos] == -1);
+                table[pos] = long(i);
+            }
+            if(ok)
+            {
+                return table;
+            }
+        }
+        size *= 2;
+    }
+}
+
+static std::string quote(const std::string& str)
+{
+    size_t i;
+    unsigned char c;
+    std::stringstream buf;
+    buf << '"';
+    for(i=0; i<str.size(); i++)
+    {
+        c = (unsigned char)(str[i]);
+        if((c == '"') || (c == '\\'))
+        {
+            buf << '\\' << char(c);
+        }
+        else if(c == '\n')
+        {
+            buf << "\\n";
+        }
+        else if((c < 0x20) || (c >= 0x7F))
+        {
+            // octal escapes, since hex escapes would swallow following hex digits
+            buf << '\\' << char('0' + ((c >> 6) & 7)) << char('0' + ((c >> 3) & 7)) << char('0' + (c & 7));
+        }
+        else
+        {
+            buf << char(c);
+        }
+    }
+    buf << '"';
+    return buf.str();
+}
+
+static std::string quotechar(char c)
+{
+    std::string str;
+    if(c == '\'')
+    {
+        return "'\\''";
+    }
+    if(c == '"')
+    {
+        return "'\"'";
+    }
+    str = quote(std::string(1, c));
+    return ("'" + str.substr(1, str.size() - 2) + "'");
+}
+
+static void writeApply(std::ostream& out, const SpecOption& opt)
+{
+    switch(opt.type)
+    {
+        case OptType::COUNT:
+            out << "                o." << opt.member << "++;\n";
+            break;
+        case OptType::STRING:
+            out << "                o." << opt.member << " = std::string(val);\n";
+            break;
+        case OptType::INT:
+            out << "                o." << opt.member << " = toint(val);\n";
+            break;
+        case OptType::LIST:
+            out << "                o." << opt.member << ".emplace_back(val);\n";
+            break;
+    }
+}
+
+static void writeHeader(std::ostream& out, const std::string& specpath, const std::string& ns, const std::vector<SpecOption>& opts, const std::string& help)
+{
+    size_t i;
+    size_t j;
+    size_t pos;
+    size_t next;
+    uint64_t seed;
+    std::vector<long> table;
+    std::vector<LongEntry> longs;
+    for(i=0; i<opts.size(); i++)
+    {
+        for(j=0; j<opts[i].longs.size(); j++)
+        {
+            longs.push_back(LongEntry{opts[i].longs[j], i});
+        }
+    }
+    table = perfectHash(longs, seed);
+    out << "// generated by optgen from " << specpath << " - do not edit.\n";
+    out << "#pragma once\n\n";
+    out << "#include <cstdint>\n#include <sstream>\n#include <stdexcept>\n#include <string>\n#include <string_view>\n#include <vector>\n\n";
+    out << "namespace " << ns << "\n{\n";
+    out << "    struct Error: std::runtime_error\n    {\n        using std::runtime_error::runtime_error;\n    };\n\n";
+    out << "    struct Options\n    {\n";
+    for(i=0; i<opts.size(); i++)
+    {
+        out << "        // " << opts[i].description << "\n";
+        switch(opts[i].type)
+        {
+            case OptType::COUNT:
+                out << "        int " << opts[i].member << " = 0;\n\n";
+                break;
+            case OptType::STRING:
+                out << "        std::string " << opts[i].member << ";\n\n";
+                break;
+            case OptType::INT:
+                out << "        long long " << opts[i].member << " = 0;\n\n";
+                break;
+            case OptType::LIST:
+                out << "        std::vector<std::string> " << opts[i].member << ";\n\n";
+                break;
+        }
+    }
+    out << "        std::vector<std::string> positional;\n    };\n\n";
+    out << "    static constexpr const char helptext[] =\n";
+    for(pos=0; pos<help.size(); pos=next)
+    {
+        next = help.find('\n', pos);
+        next = ((next == std::string::npos) ? help.size() : (next + 1));
+        out << "        " << quote(help.substr(pos, next - pos)) << "\n";
+    }
+    out << "    ;\n\n";
+    out << "    namespace detail\n    {\n";
+    out << "        struct LongSlot\n        {\n            const char* name;\n            int option;\n        };\n\n";
+    out << "        static constexpr LongSlot longslots[" << table.size() << "] =\n        {\n";
+    for(i=0; i<table.size(); i++)
+    {
+        if(table[i] == -1)
+        {
+            out << "            {nullptr, -1},\n";
+        }
+        else
+        {
+            out << "            {" << quote(longs[table[i]].name) << ", " << longs[table[i]].option << "},\n";
+        }
+    }
+    out << "        };\n\n";
+    out << "        inline int findlong(std::string_view name)\n        {\n";
+    out << "            uint64_t h = (14695981039346656037ull ^ " << seed << "ull);\n";
+    out << "            for(char c: name)\n            {\n                h ^= uint64_t((unsigned char)(c));\n                h *= 1099511628211ull;\n            }\n";
+    out << "            const LongSlot& slot = longslots[(h ^ (h >> 29)) & " << (table.size() - 1) << "];\n";
+    out << "            return (((slot.name != nullptr) && (name == slot.name)) ? slot.option : -1);\n        }\n\n";
+    out << "        inline int findshort(char c)\n        {\n            switch(c)\n            {\n";
+    for(i=0; i<opts.size(); i++)
+    {
+        for(j=0; j<opts[i].shorts.size(); j++)
+        {
+            out << "                case " << quotechar(opts[i].shorts[j]) << ": return " << i << ";\n";
+        }
+    }
+    out << "                default: return -1;\n            }\n        }\n\n";
+    out << "        inline bool needvalue(int opt)\n        {\n            switch(opt)\n            {\n";
+    for(i=0; i<opts.size(); i++)
+    {
+        if(opts[i].needvalue)
+        {
+            out << "                case " << i << ":\n";
+        }
+    }
+    out << "                    return true;\n                default:\n                    return false;\n            }\n        }\n\n";
+    out << "        inline long long toint(std::string_view val)\n        {\n";
+    out << "            long long dest;\n            std::stringstream buf;\n            buf << val;\n";
+    out << "            if(!(buf >> dest))\n            {\n                throw Error(\"lexical_convert failed\");\n            }\n            return dest;\n        }\n\n";
+    out << "        inline void apply(Options& o, int opt, std::string_view val)\n        {\n            (void)val;\n            switch(opt)\n            {\n";
+    for(i=0; i<opts.size(); i++)
+    {
+        out << "            case " << i << ":\n";
+        writeApply(out, opts[i]);
+        out << "                break;\n";
+    }
+    out << "            }\n        }\n\n";
+    // same rules as BasicOptionParser::decodeutf8(), but only the length is needed
+    out << "        inline size_t charlen(const std::string& str, size_t i)\n        {\n";
+    out << "            size_t j;\n            size_t cnt;\n            unsigned lead = (unsigned char)(str[i]);\n";
+    out << "            if((lead < 0xC2) || (lead > 0xF4))\n            {\n                return 1;\n            }\n";
+    out << "            cnt = ((lead < 0xE0) ? 2 : ((lead < 0xF0) ? 3 : 4));\n";
+    out << "            if((str.size() - i) < cnt)\n            {\n                return 1;\n            }\n";
+    out << "            uint32_t cp = (lead & (0x7F >> cnt));\n";
+    out << "            for(j=1; j<cnt; j++)\n            {\n";
+    out << "                if((((unsigned char)(str[i + j])) & 0xC0) != 0x80)\n                {\n                    return 1;\n                }\n";
+    out << "                cp = ((cp << 6) | (((unsigned char)(str[i + j])) & 0x3F));\n            }\n";
+    out << "            static constexpr uint32_t mincp[5] = {0, 0, 0x80, 0x800, 0x10000};\n";
+    out << "            if((cp < mincp[cnt]) || (cp > 0x10FFFF) || ((cp >= 0xD800) && (cp <= 0xDFFF)))\n            {\n                return 1;\n            }\n";
+    out << "            return cnt;\n        }\n    }\n\n";
+    out << "    /*\n    * parses $args into $o, like BasicOptionParser::parse() would, with the options of the spec.\n";
+    out << "    * errors throw Error, with the same message as the runtime parser.\n    */\n";
+    out << R"(    inline void parse(Options& o, const std::vector<std::string>& args)
+    {
+        size_t i;
+        size_t j;
+        size_t len;
+        size_t eqpos;
+        int opt;
+        bool stop;
+        stop = false;
+        for(i=0; i<args.size(); i++)
+        {
+            const std::string& arg = args[i];
+            if(!stop && (arg == "--"))
+            {
+                stop = true;
+                continue;
+            }
+            if(stop || (arg.empty()) || (arg[0] != '-'))
+            {
+                o.positional.push_back(arg);
+                continue;
+            }
+            if(arg[1] == '-')
+            {
+                eqpos = arg.find('=');
+                std::string_view name = std::string_view(arg).substr(2, ((eqpos == std::string::npos) ? arg.size() : eqpos) - 2);
+                opt = detail::findlong(name);
+                if(opt == -1)
+                {
+                    throw Error("unknown option '" + std::string(name) + "'");
+                }
+                if(detail::needvalue(opt))
+                {
+                    if(eqpos == std::string::npos)
+                    {
+                        throw Error("option '" + std::string(name) + "' expected a value");
+                    }
+                    detail::apply(o, opt, std::string_view(arg).substr(eqpos + 1));
+                }
+                else
+                {
+                    detail::apply(o, opt, std::string_view());
+                }
+                continue;
+            }
+            len = ((arg.size() > 1) ? detail::charlen(arg, 1) : 1);
+            if(arg.size() > (len + 1))
+            {
+                for(j=1; j<arg.size(); j+=len)
+                {
+                    len = detail::charlen(arg, j);
+                    opt = ((len == 1) ? detail::findshort(arg[j]) : -1);
+                    if(opt == -1)
+                    {
+                        throw Error("unknown short option '-" + arg.substr(j, len) + "'");
+                    }
+                    if(detail::needvalue(opt))
+                    {
+                        if(j != 1)
+                        {
+                            throw Error("unexpected option '-" + arg.substr(j, len) + "' requiring a value");
+                        }
+                        detail::apply(o, opt, std::string_view(arg).substr(2));
+                        break;
+                    }
+                    detail::apply(o, opt, std::string_view());
+                }
+                continue;
+            }
+            opt = ((len == 1) ? detail::findshort(arg[1]) : -1);
+            if(opt == -1)
+            {
+                throw Error("unknown option '" + arg + "'");
+            }
+            if(detail::needvalue(opt))
+            {
+                if(((i + 1) < args.size()) && (args[i + 1][0] != '-'))
+                {
+                    i++;
+                    detail::apply(o, opt, args[i]);
+                    continue;
+                }
+                throw Error("option '" + arg + "' expected a value");
+            }
+            detail::apply(o, opt, std::string_view());
+        }
+    }
+
+    inline void parse(Options& o, int argc, char** argv, int begin=1)
+    {
+        int i;
+        std::vector<std::string> args;
+        for(i=begin; i<argc; i++)
+        {
+            args.push_back(argv[i]);
+        }
+        parse(o, args);
+    }
+
+)";
+    out << "    /*\n    * declares the options of the spec on the runtime parser $prs, storing into $o.\n    */\n";
+    out << "    template<typename ParserT>\n    void declare(ParserT& prs, Options& o)\n    {\n";
+    for(i=0; i<opts.size(); i++)
+    {
+        out << "        prs.on({";
+        for(j=0; j<opts[i].patterns.size(); j++)
+        {
+            out << ((j > 0) ? ", " : "") << quote(opts[i].patterns[j]);
+        }
+        out << "}, " << quote(opts[i].description) << ", ";
+        if(opts[i].type == OptType::COUNT)
+        {
+            out << "[&o]\n        {\n            detail::apply(o, " << i << ", std::string_view());\n        });\n";
+        }
+        else
+        {
+            out << "[&o](const auto& v)\n        {\n            detail::apply(o, " << i << ", v.str());\n        });\n";
+        }
+    }
+    out << "    }\n}\n";
+}
+
+int main(int argc, char* argv[])
+{
+    std::string ns;
+    std::vector<SpecOption> opts;
+    if((argc < 3) || (argc > 4))
+    {
+        std::cerr << "usage: " << argv[0] << " <specfile> <output.hpp> [<namespace>]" << std::endl;
+        return 1;
+    }
+    ns = ((argc == 4) ? argv[3] : "options");
+    try
+    {
+        OptionParser prs(false);
+        opts = readSpec(argv[1]);
+        declareSpec(argv[1], prs, opts);
+        std::ofstream out(argv[2]);
+        if(!out.good())
+        {
+            throw std::runtime_error(std::string("cannot open '") + argv[2] + "' for writing");
+        }
+        writeHeader(out, argv[1], ns, opts, prs.help());
+    }
+    catch(std::exception& ex)
+    {
+        std::cerr << "optgen: " << ex.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}